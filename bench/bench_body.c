@@ -0,0 +1,120 @@
+/**
+ * @file bench_body.c
+ * @brief Request body serialization microbenchmark
+ *
+ * Compares building the screenshot request body as a cJSON tree and
+ * printing it, as pxshot_screenshot() used to, with the direct serializer
+ * writing into a reusable buffer. The baseline uses the cJSON subset
+ * still shipped as include/cJSON.h. Reports time and allocations per body.
+ * No network traffic is involved.
+ *
+ * Usage: bench_body [iterations]
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint64_t allocations;
+
+static void *counting_malloc(size_t size, void *ctx) {
+    (void)ctx;
+    allocations++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *ctx) {
+    (void)ctx;
+    allocations++;
+    return realloc(ptr, size);
+}
+
+static void counting_free(void *ptr, void *ctx) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const pxshot_allocator_t COUNTING = { counting_malloc, counting_realloc, counting_free, NULL };
+
+#define CJSON_MALLOC(size) counting_malloc(size, NULL)
+#define CJSON_FREE(ptr) counting_free(ptr, NULL)
+#include "cJSON.h"
+
+/* The body construction performed before the direct serializer existed */
+static char *legacy_build_body(const pxshot_screenshot_opts_t *opts) {
+    cJSON *body = cJSON_CreateObject();
+    if (!body) return NULL;
+
+    cJSON_AddStringToObject(body, "url", opts->url);
+    cJSON_AddStringToObject(body, "format", pxshot_format_string(opts->format));
+    if (opts->quality > 0)
+        cJSON_AddNumberToObject(body, "quality", opts->quality);
+    if (opts->width > 0)
+        cJSON_AddNumberToObject(body, "width", opts->width);
+    if (opts->height > 0)
+        cJSON_AddNumberToObject(body, "height", opts->height);
+    if (opts->full_page)
+        cJSON_AddBoolToObject(body, "full_page", true);
+    if (opts->wait_until != PXSHOT_WAIT_LOAD)
+        cJSON_AddStringToObject(body, "wait_until", pxshot_wait_until_string(opts->wait_until));
+    if (opts->wait_for_selector)
+        cJSON_AddStringToObject(body, "wait_for_selector", opts->wait_for_selector);
+    if (opts->wait_for_timeout > 0)
+        cJSON_AddNumberToObject(body, "wait_for_timeout", opts->wait_for_timeout);
+    if (opts->device_scale_factor > 0)
+        cJSON_AddNumberToObject(body, "device_scale_factor", opts->device_scale_factor);
+    if (opts->store)
+        cJSON_AddBoolToObject(body, "store", true);
+
+    char *json_str = cJSON_PrintUnformatted(body);
+    cJSON_Delete(body);
+    return json_str;
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    if (iterations <= 0) iterations = 1000000;
+
+    pxshot_screenshot_opts_t opts = {
+        .url = "https://example.com/products/12345?ref=homepage&utm_source=newsletter",
+        .format = PXSHOT_FORMAT_WEBP,
+        .quality = 85,
+        .width = 1920,
+        .height = 1080,
+        .full_page = true,
+        .wait_until = PXSHOT_WAIT_NETWORKIDLE,
+        .wait_for_selector = "#content .product-gallery",
+        .device_scale_factor = 2
+    };
+
+    size_t sink = 0;
+    allocations = 0;
+    uint64_t start = pxshot_clock_ns();
+    for (long i = 0; i < iterations; i++) {
+        char *body = legacy_build_body(&opts);
+        sink += strlen(body);
+        pxshot_mem_free(&COUNTING, body);
+    }
+    uint64_t tree_ns = pxshot_clock_ns() - start;
+    uint64_t tree_allocs = allocations;
+
+    char storage[PXSHOT_BODY_INLINE];
+    allocations = 0;
+    start = pxshot_clock_ns();
+    for (long i = 0; i < iterations; i++) {
+        char *body = pxshot_build_body(&COUNTING, &opts, storage, sizeof(storage));
+        sink += strlen(body);
+        if (body != storage) pxshot_mem_free(&COUNTING, body);
+    }
+    uint64_t direct_ns = pxshot_clock_ns() - start;
+    uint64_t direct_allocs = allocations;
+
+    printf("Request body serialization (%ld iterations, %zu bytes)\n", iterations, sink / (2 * (size_t)iterations));
+    printf("  cJSON tree + print: %8.1f ns/body  %6.1f allocs/body\n",
+           (double)tree_ns / iterations, (double)tree_allocs / iterations);
+    printf("  direct serializer:  %8.1f ns/body  %6.1f allocs/body\n",
+           (double)direct_ns / iterations, (double)direct_allocs / iterations);
+    return 0;
+}
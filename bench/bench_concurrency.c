@@ -0,0 +1,236 @@
+/**
+ * @file bench_concurrency.c
+ * @brief Adaptive concurrency benchmark
+ *
+ * Runs a batch of captures against an in-process HTTP/1.1 stand-in for the
+ * API that renders a limited number of pages at once with variable service
+ * time, queueing the rest. Halfway through the run its capacity drops, as
+ * when the service degrades. Compares a fixed batch concurrency with the
+ * adaptive concurrency limit and reports throughput, the time requests spent
+ * queued server-side, and how the adaptive limit followed the capacity.
+ *
+ * Usage: bench_concurrency [captures] [fixed_concurrency]
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define SLOTS_BEFORE 16
+#define SLOTS_AFTER 4
+#define SERVICE_MIN_US 2000
+#define SERVICE_MAX_US 8000
+
+static pthread_mutex_t slot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t slot_free = PTHREAD_COND_INITIALIZER;
+static int slots_busy;
+static int slots_total = SLOTS_BEFORE;
+
+static uint64_t *queue_us;          /* Server-side queueing per request */
+static atomic_uint request_counter;
+
+static void render(void) {
+    uint64_t arrived = pxshot_clock_ns();
+    pthread_mutex_lock(&slot_lock);
+    while (slots_busy >= slots_total) pthread_cond_wait(&slot_free, &slot_lock);
+    slots_busy++;
+    pthread_mutex_unlock(&slot_lock);
+
+    unsigned id = atomic_fetch_add(&request_counter, 1);
+    queue_us[id] = (pxshot_clock_ns() - arrived) / 1000u;
+    usleep(SERVICE_MIN_US + (unsigned)((id * 2654435761u) % (SERVICE_MAX_US - SERVICE_MIN_US)));
+
+    pthread_mutex_lock(&slot_lock);
+    slots_busy--;
+    pthread_cond_signal(&slot_free);
+    pthread_mutex_unlock(&slot_lock);
+}
+
+/* Serve keep-alive requests on one connection */
+static void *serve_connection(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char buf[8192];
+    size_t have = 0;
+
+    for (;;) {
+        char *end = NULL;
+        while (!(end = strstr(buf, "\r\n\r\n"))) {
+            ssize_t n = recv(fd, buf + have, sizeof(buf) - have - 1, 0);
+            if (n <= 0) goto done;
+            have += (size_t)n;
+            buf[have] = '\0';
+        }
+
+        size_t header_len = (size_t)(end - buf) + 4;
+        size_t body_len = 0;
+        const char *cl = strstr(buf, "Content-Length:");
+        if (cl && cl < end) body_len = strtoul(cl + 15, NULL, 10);
+        while (have < header_len + body_len) {
+            ssize_t n = recv(fd, buf + have, sizeof(buf) - have - 1, 0);
+            if (n <= 0) goto done;
+            have += (size_t)n;
+        }
+
+        render();
+
+        static const char reply[] =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: image/png\r\n"
+            "Content-Length: 16\r\n"
+            "\r\n"
+            "0123456789abcdef";
+        if (send(fd, reply, sizeof(reply) - 1, MSG_NOSIGNAL) < 0) goto done;
+
+        have -= header_len + body_len;
+        memmove(buf, buf + header_len + body_len, have);
+        buf[have] = '\0';
+    }
+
+done:
+    close(fd);
+    return NULL;
+}
+
+static void *serve(void *arg) {
+    int listener = (int)(intptr_t)arg;
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) return NULL;
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve_connection, (void *)(intptr_t)fd) == 0) {
+            pthread_detach(thread);
+        } else {
+            close(fd);
+        }
+    }
+}
+
+static int start_server(void) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    if (listener < 0 ||
+        bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listener, 512) < 0 ||
+        getsockname(listener, (struct sockaddr *)&addr, &addr_len) < 0) {
+        return -1;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, serve, (void *)(intptr_t)listener) != 0) return -1;
+    pthread_detach(thread);
+    return ntohs(addr.sin_port);
+}
+
+typedef struct {
+    pxshot_client_t *client;
+    size_t count;
+    size_t completed;
+    size_t failures;
+    bool trace;
+} run_t;
+
+static void on_item(size_t index, pxshot_response_t *resp, void *userdata) {
+    (void)index;
+    run_t *run = (run_t *)userdata;
+    if (resp->error != PXSHOT_OK) run->failures++;
+    pxshot_response_free(resp);
+
+    run->completed++;
+    if (run->completed == run->count / 2) {
+        pthread_mutex_lock(&slot_lock);
+        slots_total = SLOTS_AFTER;
+        pthread_mutex_unlock(&slot_lock);
+    }
+    if (run->trace && run->completed % (run->count / 8) == 0) {
+        pxshot_concurrency_stats_t stats;
+        pxshot_get_concurrency_stats(run->client, &stats);
+        printf("    %5zu done: limit %3d, rtt %5.1f ms (baseline %5.1f ms)\n",
+               run->completed, stats.limit, stats.rtt_ms, stats.rtt_baseline_ms);
+    }
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int run_batch(const char *base_url, const char *label, bool adaptive,
+                     size_t count, size_t concurrency) {
+    pxshot_config_t config = {
+        .api_key = "px_benchmark_key",
+        .base_url = base_url,
+        .pool_max = 256,
+        .concurrency = { .adaptive = adaptive, .initial_limit = 8 }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    if (!client) {
+        fprintf(stderr, "Error: Failed to create client\n");
+        return 1;
+    }
+
+    slots_total = SLOTS_BEFORE;
+    atomic_store(&request_counter, 0);
+
+    pxshot_screenshot_opts_t *opts = calloc(count, sizeof(*opts));
+    for (size_t i = 0; i < count; i++) opts[i].url = "https://example.com";
+
+    printf("  %s\n", label);
+    run_t run = { .client = client, .count = count, .trace = adaptive };
+    uint64_t start = pxshot_clock_ns();
+    pxshot_error_t err = pxshot_screenshot_batch(client, opts, count, concurrency, on_item, &run, NULL);
+    double seconds = (double)(pxshot_clock_ns() - start) / 1e9;
+
+    unsigned served = atomic_load(&request_counter);
+    qsort(queue_us, served, sizeof(*queue_us), compare_u64);
+    double mean = 0;
+    for (unsigned i = 0; i < served; i++) mean += (double)queue_us[i];
+    mean = served ? mean / served / 1000.0 : 0;
+    double p99 = served ? (double)queue_us[served * 99 / 100] / 1000.0 : 0;
+
+    printf("    %.0f captures/s, server queueing mean %.1f ms, p99 %.1f ms\n",
+           (double)count / seconds, mean, p99);
+
+    free(opts);
+    pxshot_free(client);
+    if (err != PXSHOT_OK || run.failures > 0) {
+        fprintf(stderr, "Error: %zu captures failed\n", run.failures);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    long count = argc > 1 ? atol(argv[1]) : 4000;
+    long fixed = argc > 2 ? atol(argv[2]) : 64;
+    if (count < 8) count = 4000;
+    if (fixed <= 0) fixed = 64;
+
+    queue_us = calloc((size_t)count, sizeof(*queue_us));
+    int port = start_server();
+    if (!queue_us || port < 0) {
+        fprintf(stderr, "Error: Failed to start local server\n");
+        return 1;
+    }
+
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    printf("Concurrency (%ld captures, server capacity %d then %d, service %d-%d ms)\n",
+           count, SLOTS_BEFORE, SLOTS_AFTER, SERVICE_MIN_US / 1000, SERVICE_MAX_US / 1000);
+
+    char label[64];
+    snprintf(label, sizeof(label), "fixed concurrency %ld", fixed);
+    int rc = run_batch(base_url, label, false, (size_t)count, (size_t)fixed);
+    if (rc == 0) rc = run_batch(base_url, "adaptive limit", true, (size_t)count, 0);
+
+    free(queue_us);
+    return rc;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file bench_executor.c
+ * @brief Executor throughput benchmark
+ *
+ * Runs a fixed number of captures through pxshot_executor_t with a growing
+ * number of worker threads and reports captures per second. Requests go to
+ * an in-process HTTP/1.1 stand-in for the API whose latency is deliberately
+ * uneven (every eighth capture is slow), so the steal count shows how often
+ * idle workers had to take jobs queued behind a slow one.
+ *
+ * Usage: bench_executor [jobs] [max_workers]
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define FAST_US 2000
+#define SLOW_US 20000
+
+static atomic_uint request_counter;
+
+/* Serve keep-alive requests on one connection */
+static void *serve_connection(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char buf[8192];
+    size_t have = 0;
+
+    for (;;) {
+        char *end = NULL;
+        while (!(end = strstr(buf, "\r\n\r\n"))) {
+            ssize_t n = recv(fd, buf + have, sizeof(buf) - have - 1, 0);
+            if (n <= 0) goto done;
+            have += (size_t)n;
+            buf[have] = '\0';
+        }
+
+        size_t header_len = (size_t)(end - buf) + 4;
+        size_t body_len = 0;
+        const char *cl = strstr(buf, "Content-Length:");
+        if (cl && cl < end) body_len = strtoul(cl + 15, NULL, 10);
+        while (have < header_len + body_len) {
+            ssize_t n = recv(fd, buf + have, sizeof(buf) - have - 1, 0);
+            if (n <= 0) goto done;
+            have += (size_t)n;
+        }
+
+        unsigned id = atomic_fetch_add(&request_counter, 1);
+        usleep(id % 8 == 0 ? SLOW_US : FAST_US);
+
+        static const char reply[] =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: image/png\r\n"
+            "Content-Length: 16\r\n"
+            "\r\n"
+            "0123456789abcdef";
+        if (send(fd, reply, sizeof(reply) - 1, MSG_NOSIGNAL) < 0) goto done;
+
+        have -= header_len + body_len;
+        memmove(buf, buf + header_len + body_len, have);
+        buf[have] = '\0';
+    }
+
+done:
+    close(fd);
+    return NULL;
+}
+
+static void *serve(void *arg) {
+    int listener = (int)(intptr_t)arg;
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) return NULL;
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve_connection, (void *)(intptr_t)fd) == 0) {
+            pthread_detach(thread);
+        } else {
+            close(fd);
+        }
+    }
+}
+
+static int start_server(void) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    if (listener < 0 ||
+        bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listener, 128) < 0 ||
+        getsockname(listener, (struct sockaddr *)&addr, &addr_len) < 0) {
+        return -1;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, serve, (void *)(intptr_t)listener) != 0) return -1;
+    pthread_detach(thread);
+    return ntohs(addr.sin_port);
+}
+
+static atomic_uint failures;
+
+static void on_complete(const pxshot_screenshot_opts_t *opts, pxshot_response_t *resp, void *userdata) {
+    (void)opts;
+    (void)userdata;
+    if (resp->error != PXSHOT_OK) atomic_fetch_add(&failures, 1);
+    pxshot_response_free(resp);
+}
+
+int main(int argc, char *argv[]) {
+    long jobs = argc > 1 ? atol(argv[1]) : 2000;
+    long max_workers = argc > 2 ? atol(argv[2]) : 32;
+    if (jobs <= 0) jobs = 2000;
+    if (max_workers <= 0) max_workers = 32;
+
+    int port = start_server();
+    if (port < 0) {
+        fprintf(stderr, "Error: Failed to start local server\n");
+        return 1;
+    }
+
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com" };
+    double ideal_ms = (FAST_US * 7 + SLOW_US) / 8 / 1000.0;
+
+    printf("Executor throughput (%ld captures, mean latency %.1f ms)\n", jobs, ideal_ms);
+    printf("  %7s  %12s  %8s  %8s\n", "workers", "captures/s", "speedup", "stolen");
+
+    double base_rate = 0;
+    for (long workers = 1; workers <= max_workers; workers *= 2) {
+        pxshot_config_t config = { .api_key = "px_benchmark_key", .base_url = base_url };
+        pxshot_client_t *client = pxshot_new_with_config(&config);
+        pxshot_executor_t *executor = client ? pxshot_executor_new(client, (size_t)workers) : NULL;
+        if (!executor) {
+            fprintf(stderr, "Error: Failed to create executor\n");
+            pxshot_free(client);
+            return 1;
+        }
+
+        uint64_t start = pxshot_clock_ns();
+        for (long i = 0; i < jobs; i++) {
+            pxshot_executor_submit(executor, &opts, on_complete, NULL);
+        }
+        pxshot_executor_wait(executor);
+        double seconds = (double)(pxshot_clock_ns() - start) / 1e9;
+
+        pxshot_executor_stats_t stats;
+        pxshot_executor_get_stats(executor, &stats);
+        double rate = (double)jobs / seconds;
+        if (base_rate == 0) base_rate = rate;
+        printf("  %7ld  %12.0f  %7.2fx  %8llu\n", workers, rate, rate / base_rate,
+               (unsigned long long)stats.stolen);
+
+        pxshot_executor_free(executor);
+        pxshot_free(client);
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "Error: %u captures failed\n", (unsigned)failures);
+        return 1;
+    }
+    return 0;
+}
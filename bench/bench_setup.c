@@ -0,0 +1,92 @@
+/**
+ * @file bench_setup.c
+ * @brief Per-request CURL setup cost microbenchmark
+ *
+ * Compares the setup work pxshot_screenshot() used to do before every
+ * transfer (curl_easy_reset, URL and auth header formatting, building a
+ * header list) with the persistent per-handle request context, which only
+ * sets the request body and write target. No network traffic is involved.
+ *
+ * Usage: bench_setup [iterations]
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *BODY = "{\"url\":\"https://example.com\",\"format\":\"png\"}";
+
+/* The per-request setup performed before the request context existed */
+static void legacy_setup(const pxshot_client_t *client, CURL *curl, pxshot_buffer_t *buffer) {
+    size_t url_len = strlen(client->base_url) + 32;
+    char *url = (char *)malloc(url_len);
+    snprintf(url, url_len, "%s/v1/screenshot", client->base_url);
+
+    size_t auth_len = strlen(client->api_key) + 32;
+    char *auth_header = (char *)malloc(auth_len);
+    snprintf(auth_header, auth_len, "Authorization: Bearer %s", client->api_key);
+
+    curl_easy_reset(curl);
+
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, auth_header);
+    headers = curl_slist_append(headers, "Content-Type: application/json");
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, BODY);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, pxshot_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, buffer);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, client->timeout_ms);
+
+    curl_slist_free_all(headers);
+    free(auth_header);
+    free(url);
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    if (iterations <= 0) iterations = 1000000;
+
+    pxshot_client_t *client = pxshot_new("px_benchmark_key");
+    if (!client) {
+        fprintf(stderr, "Error: Failed to create client\n");
+        return 1;
+    }
+
+    pxshot_conn_t *conn = pxshot_pool_acquire(&client->pool);
+    if (!conn) {
+        fprintf(stderr, "Error: Failed to acquire CURL handle\n");
+        pxshot_free(client);
+        return 1;
+    }
+
+    pxshot_buffer_t buffer = {0};
+
+    uint64_t start = pxshot_clock_ns();
+    for (long i = 0; i < iterations; i++) {
+        legacy_setup(client, conn->curl, &buffer);
+    }
+    uint64_t legacy_ns = pxshot_clock_ns() - start;
+
+    /* The legacy path reset the handle; restore its persistent options */
+    curl_easy_reset(conn->curl);
+    pxshot_conn_setup(conn->curl, client);
+    conn->endpoint = PXSHOT_ENDPOINT_NONE;
+
+    start = pxshot_clock_ns();
+    for (long i = 0; i < iterations; i++) {
+        pxshot_setup_screenshot(client, conn, BODY, &buffer);
+    }
+    uint64_t context_ns = pxshot_clock_ns() - start;
+
+    printf("Per-request setup cost (%ld iterations)\n", iterations);
+    printf("  reset + rebuild:  %8.1f ns/request\n", (double)legacy_ns / iterations);
+    printf("  request context:  %8.1f ns/request\n", (double)context_ns / iterations);
+
+    pxshot_pool_release(&client->pool, conn);
+    pxshot_free(client);
+    return 0;
+}
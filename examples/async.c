@@ -0,0 +1,68 @@
+/**
+ * @file async.c
+ * @brief Asynchronous capture example
+ *
+ * Submits several captures at once and collects them as they complete,
+ * all from a single thread.
+ */
+
+#include <pxshot.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void on_complete(pxshot_request_t *req, pxshot_response_t *resp, void *userdata) {
+    (void)req;
+    const char *url = (const char *)userdata;
+
+    if (resp->error == PXSHOT_OK) {
+        printf("  %s: %zu bytes\n", url, resp->data_len);
+    } else {
+        printf("  %s: error: %s\n", url, pxshot_error_string(resp->error));
+    }
+
+    /* The callback owns the response */
+    pxshot_response_free(resp);
+}
+
+int main(int argc, char *argv[]) {
+    const char *api_key = getenv("PXSHOT_API_KEY");
+    if (!api_key) {
+        fprintf(stderr, "Error: PXSHOT_API_KEY environment variable not set\n");
+        return 1;
+    }
+
+    const char *defaults[] = { "https://example.com", "https://example.org", "https://example.net" };
+    const char **urls = argc > 1 ? (const char **)&argv[1] : defaults;
+    int count = argc > 1 ? argc - 1 : 3;
+
+    printf("Pxshot C SDK v%s\n", pxshot_version());
+    printf("Capturing %d pages concurrently\n", count);
+
+    /* Create client */
+    pxshot_client_t *client = pxshot_new(api_key);
+    if (!client) {
+        fprintf(stderr, "Error: Failed to create client\n");
+        return 1;
+    }
+
+    /* Submit all captures without blocking */
+    for (int i = 0; i < count; i++) {
+        pxshot_screenshot_opts_t opts = { .url = urls[i] };
+        if (!pxshot_submit(client, &opts, on_complete, (void *)urls[i])) {
+            fprintf(stderr, "Error: Failed to submit %s\n", urls[i]);
+        }
+    }
+
+    /* Drive transfers until everything has completed */
+    while (pxshot_pending(client) > 0) {
+        if (pxshot_poll(client, 1000) < 0) {
+            fprintf(stderr, "Error: Polling failed\n");
+            break;
+        }
+    }
+
+    /* Cleanup */
+    pxshot_free(client);
+
+    return 0;
+}
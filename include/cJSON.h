@@ -88,8 +88,16 @@ typedef int cJSON_bool;
 #include <ctype.h>
 #include <float.h>
 
-static void *cJSON_malloc(size_t size) { return malloc(size); }
-static void cJSON_free(void *ptr) { free(ptr); }
+/* Define before including to route allocations elsewhere */
+#ifndef CJSON_MALLOC
+#define CJSON_MALLOC(size) malloc(size)
+#endif
+#ifndef CJSON_FREE
+#define CJSON_FREE(ptr) free(ptr)
+#endif
+
+static void *cJSON_malloc(size_t size) { return CJSON_MALLOC(size); }
+static void cJSON_free(void *ptr) { CJSON_FREE(ptr); }
 
 static cJSON *cJSON_New_Item(void)
 {
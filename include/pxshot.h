@@ -35,6 +35,7 @@ extern "C" {
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 /* Version information */
 #define PXSHOT_VERSION_MAJOR 1
@@ -58,7 +59,13 @@ typedef enum {
     PXSHOT_ERR_JSON_PARSE,      /**< Failed to parse JSON response */
     PXSHOT_ERR_API_ERROR,       /**< API returned an error */
     PXSHOT_ERR_TIMEOUT,         /**< Request timed out */
-    PXSHOT_ERR_UNKNOWN          /**< Unknown error */
+    PXSHOT_ERR_UNKNOWN,         /**< Unknown error */
+    /* New codes go last so existing values keep their meaning */
+    PXSHOT_ERR_CANCELLED,       /**< Request cancelled through its cancellation token */
+    PXSHOT_ERR_DEADLINE,        /**< Request deadline passed */
+    PXSHOT_ERR_CIRCUIT_OPEN,    /**< Endpoint circuit breaker is open; request not sent */
+    PXSHOT_ERR_RATE_LIMITED,    /**< Client-side rate limit or plan quota reached; request not sent */
+    PXSHOT_ERR_SINK_WRITE       /**< Writing streamed image bytes to the sink failed */
 } pxshot_error_t;
 
 /**
@@ -83,10 +90,181 @@ typedef enum {
  * @brief Opaque client handle
  * 
  * Created with pxshot_new(), freed with pxshot_free().
- * Thread-safe for concurrent requests.
+ * The blocking API is thread-safe: concurrent requests check CURL handles
+ * out of a per-client pool, so worker threads can share one client and its
+ * warm connections.
  */
 typedef struct pxshot_client pxshot_client_t;
 
+/**
+ * @brief Opaque shared-state handle
+ * 
+ * Created with pxshot_share_new(), freed with pxshot_share_free().
+ * Lets several clients share DNS entries, TLS sessions and the connection
+ * cache. Thread-safe.
+ */
+typedef struct pxshot_share pxshot_share_t;
+
+/**
+ * @brief Cancellation token (opaque)
+ *
+ * Created with pxshot_cancel_new(), freed with pxshot_cancel_free().
+ * One token can be attached to any number of requests.
+ */
+typedef struct pxshot_cancel pxshot_cancel_t;
+
+/**
+ * @brief Retry policy for blocking screenshot requests
+ *
+ * Retryable failures (transport errors, timeouts, HTTP 408/429/5xx) are
+ * retried with decorrelated-jitter backoff. A Retry-After header raises the
+ * delay. Every request adds budget_ratio to a client-wide retry budget and
+ * every retry spends one, so during an outage retries stay at a fraction
+ * of normal traffic instead of multiplying it.
+ */
+typedef struct {
+    int max_attempts;           /**< Attempts per request, including the first (0 or 1 = no retries) */
+    long base_delay_ms;         /**< Smallest backoff delay (0 = default 100) */
+    long max_delay_ms;          /**< Largest backoff delay; a longer Retry-After stops retrying (0 = default 10000) */
+    double budget_ratio;        /**< Retries earned per request (0 = default 0.1) */
+    int budget_max;             /**< Retries that can be banked, also the initial balance (0 = default 10) */
+} pxshot_retry_policy_t;
+
+/**
+ * @brief Hedging policy for blocking screenshot requests
+ *
+ * When a request has had no response for longer than the given percentile
+ * of recent request latencies, a duplicate is sent; the first to finish is
+ * used and the other is cancelled. max_rate caps hedges as a fraction of
+ * requests so stalls cannot double API usage.
+ */
+typedef struct {
+    double percentile;          /**< Hedge after this fraction of recent latencies, e.g. 0.95 (0 = no hedging) */
+    long min_delay_ms;          /**< Never hedge sooner than this (0 = default 20) */
+    double max_rate;            /**< Hedges allowed per request (0 = default 0.05) */
+    int min_samples;            /**< Latency samples needed before hedging starts (0 = default 20) */
+} pxshot_hedge_policy_t;
+
+/**
+ * @brief Circuit breaker policy, applied to each API endpoint separately
+ *
+ * Failures are transient errors (transport errors, timeouts, HTTP
+ * 408/429/5xx) and, if slow_call_ms is set, calls slower than that. When
+ * the failure ratio over the rolling window reaches failure_ratio, the
+ * circuit opens and requests fail at once with PXSHOT_ERR_CIRCUIT_OPEN.
+ * After open_ms it lets half_open_probes requests through; it closes once
+ * they all succeed and reopens if one fails.
+ */
+typedef struct {
+    double failure_ratio;       /**< Failure ratio that opens the circuit, e.g. 0.5 (0 = no breaker) */
+    int min_requests;           /**< Requests in the window before the ratio counts (0 = default 20) */
+    long window_ms;             /**< Rolling window length (0 = default 10000) */
+    long slow_call_ms;          /**< Calls at least this slow count as failures (0 = latency ignored) */
+    long open_ms;               /**< Time open before probing (0 = default 5000) */
+    int half_open_probes;       /**< Probe requests needed to close again (0 = default 1) */
+} pxshot_circuit_policy_t;
+
+/**
+ * @brief Client-side rate limit (token bucket shared by all threads)
+ *
+ * Every screenshot attempt takes a token. Tokens refill at requests_per_sec
+ * and up to burst of them accumulate. With adaptive set, the rate is also
+ * lowered to pace the plan's remaining screenshots over the rest of the
+ * billing period, using the figures from pxshot_get_usage(). The usage is
+ * re-read every recalibrate_ms by pxshot_screenshot(), and any call to
+ * pxshot_get_usage() recalibrates too.
+ */
+typedef struct {
+    double requests_per_sec;    /**< Sustained request rate (0 = no fixed rate) */
+    int burst;                  /**< Bucket size (0 = default 10) */
+    bool fail_fast;             /**< Fail with PXSHOT_ERR_RATE_LIMITED instead of waiting for a token */
+    bool adaptive;              /**< Pace the remaining plan quota over the billing period */
+    long recalibrate_ms;        /**< Usage refresh interval in adaptive mode (0 = default 300000) */
+} pxshot_rate_limit_t;
+
+/**
+ * @brief Adaptive concurrency limit for asynchronous requests
+ *
+ * Caps how many pxshot_submit() transfers run at once and tunes the cap
+ * from observed latency, in the style of the gradient algorithm from
+ * Netflix's concurrency-limits: the limit grows while recent latency stays
+ * within rtt_tolerance of the long-term baseline, shrinks in proportion
+ * once requests start queueing server-side, and backs off multiplicatively
+ * on timeouts and transient errors. Requests over the limit wait, not yet
+ * started, until a slot frees up.
+ */
+typedef struct {
+    bool adaptive;              /**< Enable the limiter */
+    int initial_limit;          /**< Starting limit (0 = default 20) */
+    int min_limit;              /**< Lowest limit (0 = default 1) */
+    int max_limit;              /**< Highest limit (0 = default 200) */
+    double rtt_tolerance;       /**< Latency over baseline tolerated before shrinking (0 = default 1.5) */
+    double smoothing;           /**< Weight of each adjustment, 0..1 (0 = default 0.2) */
+} pxshot_concurrency_policy_t;
+
+/**
+ * @brief In-memory screenshot cache
+ *
+ * Keeps recent images (store=false captures) keyed by their canonical
+ * options, evicting the least recently used once max_bytes is reached.
+ * A hit answers pxshot_screenshot() or pxshot_submit() without a request.
+ */
+typedef struct {
+    size_t max_bytes;           /**< Total byte budget (0 = no cache) */
+    long ttl_ms;                /**< How long an image stays fresh (0 = default 300000) */
+    int shards;                 /**< Independently locked partitions (0 = default 16) */
+} pxshot_cache_policy_t;
+
+/**
+ * @brief Persistent on-disk screenshot cache
+ *
+ * Keeps images (store=false captures) in a directory so they survive
+ * restarts. Image files are named by a hash of their bytes, so identical
+ * images are stored once, and a compact index maps each canonical set of
+ * options to its image. Hits are memory-mapped rather than read. Only one
+ * client at a time may use a directory.
+ */
+typedef struct {
+    const char *dir;            /**< Cache directory, created if missing (NULL = no disk cache) */
+    uint64_t max_bytes;         /**< Disk quota for image files (0 = default 1 GiB) */
+    long ttl_ms;                /**< How long an image stays fresh (0 = default 86400000) */
+} pxshot_disk_cache_policy_t;
+
+/**
+ * @brief Reuse of stored screenshots
+ *
+ * Remembers the result of store=true captures by their canonical options.
+ * Repeating such a capture returns the remembered URL without a request
+ * while it stays valid for at least margin_ms more.
+ */
+typedef struct {
+    size_t max_entries;         /**< Results remembered, least recently used dropped first (0 = off) */
+    long margin_ms;             /**< Validity that must remain for reuse (0 = default 60000) */
+} pxshot_stored_reuse_t;
+
+/**
+ * @brief Memory allocator
+ *
+ * All three functions are required. realloc_fn and free_fn are only given
+ * pointers that came from the same allocator.
+ */
+typedef struct {
+    void *(*malloc_fn)(size_t size, void *ctx);
+    void *(*realloc_fn)(void *ptr, size_t size, void *ctx);
+    void (*free_fn)(void *ptr, void *ctx);
+    void *ctx;                  /**< Passed to every call */
+} pxshot_allocator_t;
+
+/**
+ * @brief Response buffer pool
+ *
+ * Keeps the body buffers of freed responses, bucketed by power-of-two size
+ * class, and hands them to later captures instead of allocating new ones.
+ */
+typedef struct {
+    size_t max_bytes;           /**< Idle buffer bytes kept for reuse (0 = off) */
+} pxshot_buffer_pool_policy_t;
+
 /**
  * @brief Client configuration options
  */
@@ -94,6 +272,22 @@ typedef struct {
     const char *api_key;        /**< API key (required) */
     const char *base_url;       /**< Base URL (optional, defaults to https://api.pxshot.com) */
     long timeout_ms;            /**< Request timeout in milliseconds (0 = default 30s) */
+    size_t pool_size;           /**< CURL handles created up front (0 = default 1) */
+    size_t pool_max;            /**< Max pooled CURL handles (0 = default 16) */
+    pxshot_share_t *share;      /**< Shared DNS/TLS/connection state (optional) */
+    bool http2;                 /**< Negotiate HTTP/2 over TLS and multiplex concurrent requests */
+    pxshot_retry_policy_t retry; /**< Retry policy for pxshot_screenshot() (default: no retries) */
+    pxshot_hedge_policy_t hedge; /**< Hedging policy for pxshot_screenshot() (default: off) */
+    pxshot_circuit_policy_t circuit; /**< Per-endpoint circuit breaker (default: off) */
+    pxshot_rate_limit_t rate_limit; /**< Client-side rate limit (default: off) */
+    pxshot_concurrency_policy_t concurrency; /**< Adaptive in-flight limit for async requests (default: off) */
+    bool coalesce;              /**< Let identical concurrent pxshot_screenshot() calls share one capture */
+    pxshot_cache_policy_t cache; /**< In-memory image cache (default: off) */
+    pxshot_disk_cache_policy_t disk_cache; /**< Persistent image cache (default: off) */
+    pxshot_stored_reuse_t stored_reuse; /**< Reuse stored screenshots until they expire (default: off) */
+    const pxshot_allocator_t *allocator; /**< Memory for the client and its responses (NULL = global allocator) */
+    pxshot_buffer_pool_policy_t buffer_pool; /**< Recycle response buffers (default: off) */
+    const char *ca_file;        /**< PEM bundle of CAs to verify the server with (NULL = libcurl default) */
 } pxshot_config_t;
 
 /**
@@ -118,6 +312,8 @@ typedef struct {
     double device_scale_factor; /**< Device pixel ratio (0 = default 1.0) */
     bool store;                 /**< Store image and return URL instead of bytes */
     bool block_ads;             /**< Block ads and trackers */
+    pxshot_cancel_t *cancel;    /**< Abort when this token is triggered (optional) */
+    uint64_t deadline_ms;       /**< Absolute deadline on the pxshot_now_ms() clock (0 = none) */
 } pxshot_screenshot_opts_t;
 
 /**
@@ -139,6 +335,11 @@ typedef struct {
  * For screenshot requests:
  * - If store=false: data/data_len contain image bytes, stored is NULL
  * - If store=true: stored contains URL info, data is NULL
+ * 
+ * Responses to coalesced requests share one copy of the image bytes, so
+ * with coalescing enabled treat data as read-only and release it only
+ * through pxshot_response_free(). Disk cache hits map the image file
+ * privately; writes to data stay in the response.
  */
 typedef struct {
     pxshot_error_t error;       /**< Error code (PXSHOT_OK on success) */
@@ -150,6 +351,13 @@ typedef struct {
     size_t data_len;            /**< Length of data in bytes */
     
     pxshot_stored_t *stored;    /**< Stored image info (for store=true) */
+
+    /* Delivery details */
+    bool retryable;             /**< Failure is transient and the request may be retried */
+    int attempts;               /**< Transfers made (0 if the request was never sent) */
+    uint64_t backoff_ms;        /**< Total time spent waiting between attempts */
+    bool cached;                /**< Answered locally from a cache or a remembered stored result */
+    uint32_t reallocs;          /**< Times the body buffer had to grow (0 when Content-Length sized it) */
 } pxshot_response_t;
 
 /**
@@ -164,10 +372,170 @@ typedef struct {
     char *period_end;           /**< Billing period end (ISO8601) */
 } pxshot_usage_t;
 
+/**
+ * @brief CURL handle pool statistics
+ */
+typedef struct {
+    size_t handles_total;       /**< Handles currently owned by the pool */
+    size_t handles_idle;        /**< Handles checked in and ready for use */
+    size_t handles_max;         /**< Pool growth cap */
+    uint64_t checkouts;         /**< Total checkouts */
+    uint64_t waits;             /**< Checkouts that had to wait for a free handle */
+    uint64_t wait_ns_total;     /**< Total time spent waiting, in nanoseconds */
+    uint64_t wait_ns_max;       /**< Longest single wait, in nanoseconds */
+} pxshot_pool_stats_t;
+
+/**
+ * @brief Transport statistics
+ */
+typedef struct {
+    uint64_t requests;          /**< Completed transfers */
+    uint64_t connections;       /**< Transfers that opened a new connection */
+    uint64_t http2_streams;     /**< Transfers carried over HTTP/2 */
+    uint64_t http2_multiplexed; /**< HTTP/2 transfers that shared their connection with another in flight */
+    uint64_t retries;           /**< Retries performed */
+    uint64_t retries_throttled; /**< Retries skipped because the retry budget was empty */
+    uint64_t hedges;            /**< Hedge requests sent */
+    uint64_t hedges_throttled;  /**< Hedges skipped because of max_rate */
+    uint64_t hedge_wins;        /**< Hedges that finished before the original request */
+    uint64_t hedge_saved_ms;    /**< Estimated latency saved by hedge wins, from recent latencies */
+    uint64_t coalesced;         /**< Calls answered by an identical capture already in flight */
+} pxshot_transport_stats_t;
+
+/**
+ * @brief API endpoints, for per-endpoint state
+ */
+typedef enum {
+    PXSHOT_API_SCREENSHOT = 0,  /**< POST /v1/screenshot */
+    PXSHOT_API_USAGE            /**< GET /v1/usage */
+} pxshot_api_t;
+
+/**
+ * @brief Circuit breaker state
+ */
+typedef enum {
+    PXSHOT_CIRCUIT_CLOSED = 0,  /**< Requests flow normally */
+    PXSHOT_CIRCUIT_OPEN,        /**< Requests fail fast */
+    PXSHOT_CIRCUIT_HALF_OPEN    /**< Probe requests are testing for recovery */
+} pxshot_circuit_state_t;
+
+/**
+ * @brief Circuit breaker statistics for one endpoint
+ */
+typedef struct {
+    pxshot_circuit_state_t state; /**< Current state */
+    uint32_t window_requests;   /**< Requests recorded in the rolling window */
+    uint32_t window_failures;   /**< Failures recorded in the rolling window */
+    uint64_t rejected;          /**< Requests failed fast while open */
+    uint64_t opened;            /**< Times the circuit has opened */
+} pxshot_circuit_stats_t;
+
+/**
+ * @brief Rate limiter statistics
+ */
+typedef struct {
+    double requests_per_sec;    /**< Current rate (0 = unlimited) */
+    bool quota_exhausted;       /**< Last usage figures showed no screenshots left */
+    uint64_t delayed;           /**< Requests that waited for a token */
+    uint64_t delay_ms;          /**< Total time requests waited */
+    uint64_t rejected;          /**< Requests failed with PXSHOT_ERR_RATE_LIMITED */
+} pxshot_rate_limit_stats_t;
+
+/**
+ * @brief Adaptive concurrency statistics
+ */
+typedef struct {
+    int limit;                  /**< Current in-flight limit (0 = unlimited) */
+    size_t active;              /**< Transfers running */
+    size_t waiting;             /**< Submitted requests not yet started */
+    double rtt_ms;              /**< Recent latency */
+    double rtt_baseline_ms;     /**< Long-term latency baseline */
+    uint64_t backoffs;          /**< Multiplicative decreases after errors */
+} pxshot_concurrency_stats_t;
+
+/**
+ * @brief In-memory cache statistics
+ */
+typedef struct {
+    uint64_t hits;              /**< Lookups answered from the cache */
+    uint64_t misses;            /**< Lookups that went to the API */
+    uint64_t evictions;         /**< Entries dropped to stay within the byte budget */
+    uint64_t expirations;       /**< Entries dropped after their TTL */
+    size_t entries;             /**< Images currently cached */
+    size_t bytes;               /**< Bytes currently charged against the budget */
+    uint64_t stored_hits;       /**< store=true captures answered with a remembered URL */
+    size_t stored_entries;      /**< Stored results remembered */
+} pxshot_cache_stats_t;
+
+/**
+ * @brief Buffer pool statistics
+ */
+typedef struct {
+    uint64_t hits;              /**< Buffers handed out from the pool */
+    uint64_t misses;            /**< Buffers allocated because their class was empty */
+    uint64_t recycled;          /**< Buffers taken back for reuse */
+    uint64_t dropped;           /**< Buffers freed because the pool was full */
+    size_t idle_buffers;        /**< Buffers waiting for reuse */
+    size_t idle_bytes;          /**< Their total capacity */
+} pxshot_buffer_pool_stats_t;
+
+/**
+ * @brief Disk cache statistics
+ */
+typedef struct {
+    uint64_t hits;              /**< Lookups answered from disk */
+    uint64_t misses;            /**< Lookups not found on disk */
+    uint64_t evictions;         /**< Entries dropped to stay within the quota */
+    uint64_t expirations;       /**< Entries dropped after their TTL */
+    size_t entries;             /**< Option sets in the index */
+    size_t files;               /**< Distinct image files */
+    uint64_t bytes;             /**< Total size of the image files */
+} pxshot_disk_cache_stats_t;
+
+/**
+ * @brief Write callback for streamed image bytes
+ *
+ * @return len to continue; any other value aborts the capture with
+ *         PXSHOT_ERR_SINK_WRITE
+ */
+typedef size_t (*pxshot_write_cb)(const uint8_t *data, size_t len, void *userdata);
+
+/**
+ * @brief Kind of destination for streamed image bytes
+ */
+typedef enum {
+    PXSHOT_SINK_CALLBACK = 0,   /**< Call write with each chunk */
+    PXSHOT_SINK_FD,             /**< write(2) to fd */
+    PXSHOT_SINK_FILE            /**< fwrite() to file */
+} pxshot_sink_type_t;
+
+/**
+ * @brief Destination for pxshot_screenshot_to_sink()
+ */
+typedef struct {
+    pxshot_sink_type_t type;
+    pxshot_write_cb write;      /**< PXSHOT_SINK_CALLBACK: chunk handler */
+    void *userdata;             /**< PXSHOT_SINK_CALLBACK: passed to write */
+    int fd;                     /**< PXSHOT_SINK_FD: open descriptor */
+    FILE *file;                 /**< PXSHOT_SINK_FILE: open stream */
+} pxshot_sink_t;
+
 /* ============================================================================
  * Client Lifecycle
  * ============================================================================ */
 
+/**
+ * @brief Set the global allocator
+ *
+ * Used by clients without their own pxshot_config_t.allocator, and by
+ * shares and cancel tokens. Set it once at startup, before any other call;
+ * the allocator must stay valid while memory from it is in use.
+ *
+ * @param allocator Allocator to use (NULL = malloc/realloc/free)
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG if a function is missing
+ */
+pxshot_error_t pxshot_set_allocator(const pxshot_allocator_t *allocator);
+
 /**
  * @brief Create a new Pxshot client with an API key
  * 
@@ -194,6 +562,75 @@ pxshot_client_t *pxshot_new_with_config(const pxshot_config_t *config);
  */
 void pxshot_free(pxshot_client_t *client);
 
+/**
+ * @brief Create a shared-state object for use by several clients
+ * 
+ * Pass it through pxshot_config_t.share. Clients keep their own reference,
+ * so the share may be freed before the clients that use it.
+ * 
+ * @return New share instance, or NULL on failure
+ */
+pxshot_share_t *pxshot_share_new(void);
+
+/**
+ * @brief Release a shared-state object
+ * 
+ * @param share Share to free (safe to pass NULL)
+ */
+void pxshot_share_free(pxshot_share_t *share);
+
+/* ============================================================================
+ * Cancellation and Deadlines
+ *
+ * A screenshot request stops as soon as its token is triggered or its
+ * deadline passes, and reports PXSHOT_ERR_CANCELLED or PXSHOT_ERR_DEADLINE.
+ * The client-wide timeout_ms still applies as an upper bound and reports
+ * PXSHOT_ERR_TIMEOUT.
+ * ============================================================================ */
+
+/**
+ * @brief Create a cancellation token
+ * 
+ * @return New token, or NULL on allocation failure
+ */
+pxshot_cancel_t *pxshot_cancel_new(void);
+
+/**
+ * @brief Cancel every request using the token
+ * 
+ * Safe to call from any thread. Requests already running stop pulling data
+ * at their next progress check; requests started later fail immediately.
+ * 
+ * @param cancel Cancellation token
+ */
+void pxshot_cancel_trigger(pxshot_cancel_t *cancel);
+
+/**
+ * @brief Check whether a token has been triggered
+ * 
+ * @param cancel Cancellation token
+ * @return true once pxshot_cancel_trigger() has been called
+ */
+bool pxshot_cancel_is_triggered(const pxshot_cancel_t *cancel);
+
+/**
+ * @brief Free a cancellation token
+ * 
+ * @param cancel Token to free (safe to pass NULL)
+ * 
+ * @note No request using the token may still be running.
+ */
+void pxshot_cancel_free(pxshot_cancel_t *cancel);
+
+/**
+ * @brief Current time on the clock used for request deadlines
+ * 
+ * Monotonic milliseconds; set opts.deadline_ms = pxshot_now_ms() + budget.
+ * 
+ * @return Current time in milliseconds
+ */
+uint64_t pxshot_now_ms(void);
+
 /* ============================================================================
  * API Operations
  * ============================================================================ */
@@ -210,6 +647,27 @@ void pxshot_free(pxshot_client_t *client);
 pxshot_response_t *pxshot_screenshot(pxshot_client_t *client, 
                                       const pxshot_screenshot_opts_t *opts);
 
+/**
+ * @brief Capture a screenshot, streaming the image to a sink
+ *
+ * Image bytes are written to the sink as they arrive instead of being
+ * collected in memory, so memory use does not grow with the image size.
+ * Error bodies are still read into the response for error_message.
+ *
+ * @param client Pxshot client
+ * @param opts Screenshot options (url is required; store must be false)
+ * @param sink Destination for the image bytes
+ * @return Response with error info; on success data is NULL and data_len
+ *         holds the number of bytes written
+ *
+ * @note Retries only happen while nothing has been written to the sink.
+ *       Hedging, coalescing and the caches do not apply.
+ * @note Caller must free the response with pxshot_response_free()
+ */
+pxshot_response_t *pxshot_screenshot_to_sink(pxshot_client_t *client,
+                                             const pxshot_screenshot_opts_t *opts,
+                                             const pxshot_sink_t *sink);
+
 /**
  * @brief Get usage statistics
  * 
@@ -221,128 +679,1368 @@ pxshot_response_t *pxshot_screenshot(pxshot_client_t *client,
  */
 pxshot_response_t *pxshot_get_usage(pxshot_client_t *client, pxshot_usage_t **usage);
 
-/* ============================================================================
- * Memory Management
- * ============================================================================ */
-
 /**
- * @brief Free a response structure
+ * @brief Get CURL handle pool statistics
  * 
- * @param resp Response to free (safe to pass NULL)
+ * @param client Pxshot client
+ * @param stats Output parameter for pool statistics
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG if an argument is NULL
  */
-void pxshot_response_free(pxshot_response_t *resp);
+pxshot_error_t pxshot_get_pool_stats(pxshot_client_t *client, pxshot_pool_stats_t *stats);
 
 /**
- * @brief Free a usage structure
+ * @brief Get transport statistics
  * 
- * @param usage Usage to free (safe to pass NULL)
+ * With http2 enabled, http2_multiplexed counts the HTTP/2 transfers that
+ * had another transfer in flight on the same connection at some point.
+ * A stream sent on a kept-alive connection after the previous one
+ * finished is not counted. Only the asynchronous engine runs transfers
+ * side by side.
+ * 
+ * @param client Pxshot client
+ * @param stats Output parameter for transport statistics
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG if an argument is NULL
  */
-void pxshot_usage_free(pxshot_usage_t *usage);
-
-/* ============================================================================
- * Utilities
- * ============================================================================ */
+pxshot_error_t pxshot_get_transport_stats(pxshot_client_t *client, pxshot_transport_stats_t *stats);
 
 /**
- * @brief Get a human-readable error message for an error code
+ * @brief Get the circuit breaker state of an endpoint
  * 
- * @param error Error code
- * @return Static string describing the error
+ * @param client Pxshot client
+ * @param api Endpoint
+ * @param stats Output parameter for breaker statistics
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG for a NULL argument or unknown endpoint
  */
-const char *pxshot_error_string(pxshot_error_t error);
+pxshot_error_t pxshot_get_circuit_stats(pxshot_client_t *client, pxshot_api_t api,
+                                        pxshot_circuit_stats_t *stats);
 
 /**
- * @brief Get the SDK version string
+ * @brief Get rate limiter statistics
  * 
- * @return Version string (e.g., "1.0.0")
+ * @param client Pxshot client
+ * @param stats Output parameter for limiter statistics
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG for a NULL argument
  */
-const char *pxshot_version(void);
+pxshot_error_t pxshot_get_rate_limit_stats(pxshot_client_t *client, pxshot_rate_limit_stats_t *stats);
 
-/* ============================================================================
- * Header-Only Implementation (optional)
- * 
- * Define PXSHOT_IMPLEMENTATION before including this header in exactly ONE
- * source file to include the implementation:
+/**
+ * @brief Get adaptive concurrency statistics
  * 
- *   #define PXSHOT_IMPLEMENTATION
- *   #include <pxshot.h>
+ * @param client Pxshot client
+ * @param stats Output parameter for limiter statistics
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG for a NULL argument
  * 
- * ============================================================================ */
+ * @note Call from the thread driving the asynchronous API.
+ */
+pxshot_error_t pxshot_get_concurrency_stats(pxshot_client_t *client, pxshot_concurrency_stats_t *stats);
 
-#ifdef PXSHOT_IMPLEMENTATION
+/**
+ * @brief Get in-memory cache statistics
+ * 
+ * @param client Pxshot client
+ * @param stats Output parameter for cache statistics
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG for a NULL argument
+ */
+pxshot_error_t pxshot_get_cache_stats(pxshot_client_t *client, pxshot_cache_stats_t *stats);
 
-#include <stdlib.h>
-#include <string.h>
-#include <stdio.h>
-#include <curl/curl.h>
+/**
+ * @brief Get disk cache statistics
+ *
+ * @param client Client instance
+ * @param stats Receives the counters (all zero when the disk cache is off)
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG if client or stats is NULL
+ */
+pxshot_error_t pxshot_get_disk_cache_stats(pxshot_client_t *client, pxshot_disk_cache_stats_t *stats);
 
-/* Bundled cJSON (minimal subset) - or use system cJSON */
-#ifndef PXSHOT_USE_SYSTEM_CJSON
-#include "cJSON.h"
-#else
-#include <cjson/cJSON.h>
-#endif
+/**
+ * @brief Get response buffer pool statistics
+ *
+ * @param client Client instance
+ * @param stats Receives the counters (all zero when the pool is off)
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG if client or stats is NULL
+ */
+pxshot_error_t pxshot_get_buffer_pool_stats(pxshot_client_t *client, pxshot_buffer_pool_stats_t *stats);
 
-/* Internal client structure */
-struct pxshot_client {
-    char *api_key;
-    char *base_url;
-    long timeout_ms;
-    CURL *curl;
-};
+/* ============================================================================
+ * Asynchronous API
+ *
+ * Non-blocking captures driven by a curl multi handle owned by the client.
+ * A single thread can keep many captures in flight: submit requests with
+ * pxshot_submit(), then drive them with pxshot_poll() or pxshot_wait_any().
+ *
+ * The asynchronous functions of one client must not be called from several
+ * threads at the same time.
+ * ============================================================================ */
 
-/* CURL write callback data */
-typedef struct {
-    uint8_t *data;
-    size_t len;
-    size_t cap;
-} pxshot_buffer_t;
+/**
+ * @brief Handle for an in-flight asynchronous capture
+ */
+typedef struct pxshot_request pxshot_request_t;
 
-/* Internal helpers */
-static size_t pxshot_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    pxshot_buffer_t *buf = (pxshot_buffer_t *)userp;
-    
-    if (buf->len + realsize + 1 > buf->cap) {
-        size_t newcap = (buf->cap == 0) ? 4096 : buf->cap * 2;
-        while (newcap < buf->len + realsize + 1) newcap *= 2;
-        uint8_t *newdata = (uint8_t *)realloc(buf->data, newcap);
-        if (!newdata) return 0;
-        buf->data = newdata;
-        buf->cap = newcap;
-    }
-    
-    memcpy(buf->data + buf->len, contents, realsize);
-    buf->len += realsize;
-    buf->data[buf->len] = 0;
-    return realsize;
-}
+/**
+ * @brief Completion callback for asynchronous captures
+ *
+ * Invoked from pxshot_poll() or pxshot_wait_any() on the driving thread.
+ * The callback takes ownership of @p resp and must free it with
+ * pxshot_response_free(). The request handle is released by the SDK once
+ * the callback returns.
+ *
+ * @param req Completed request
+ * @param resp Response (same layout as pxshot_screenshot())
+ * @param userdata Pointer passed to pxshot_submit()
+ */
+typedef void (*pxshot_request_cb)(pxshot_request_t *req, pxshot_response_t *resp, void *userdata);
 
-static char *pxshot_strdup(const char *s) {
-    if (!s) return NULL;
-    size_t len = strlen(s);
-    char *dup = (char *)malloc(len + 1);
-    if (dup) memcpy(dup, s, len + 1);
-    return dup;
-}
+/**
+ * @brief Submit a screenshot capture without blocking
+ *
+ * @param client Pxshot client
+ * @param opts Screenshot options (url is required; copied before returning)
+ * @param on_complete Completion callback, or NULL for a future-style handle
+ * @param userdata Opaque pointer passed to the callback
+ * @return Request handle, or NULL if it could not be allocated
+ *
+ * @note Errors detected at submission (e.g. missing url) are reported as a
+ *       completed request, exactly like a failed transfer.
+ * @note Without a callback, collect the result with pxshot_request_finish().
+ */
+pxshot_request_t *pxshot_submit(pxshot_client_t *client,
+                                const pxshot_screenshot_opts_t *opts,
+                                pxshot_request_cb on_complete,
+                                void *userdata);
 
-static pxshot_response_t *pxshot_response_new(void) {
-    pxshot_response_t *resp = (pxshot_response_t *)calloc(1, sizeof(pxshot_response_t));
-    return resp;
-}
+/**
+ * @brief Drive in-flight requests and dispatch completion callbacks
+ *
+ * @param client Pxshot client
+ * @param timeout_ms Maximum time to wait for network activity (0 = don't wait)
+ * @return Number of requests still in flight, or -1 on error
+ */
+int pxshot_poll(pxshot_client_t *client, int timeout_ms);
 
-static void pxshot_set_error(pxshot_response_t *resp, pxshot_error_t err, const char *msg) {
-    resp->error = err;
-    if (msg) resp->error_message = pxshot_strdup(msg);
-}
+/**
+ * @brief Wait until any future-style request completes
+ *
+ * Callback-style requests that complete meanwhile are dispatched as usual.
+ *
+ * @param client Pxshot client
+ * @param timeout_ms Maximum time to wait (negative = wait indefinitely)
+ * @return A completed request, or NULL on timeout or when nothing is pending
+ */
+pxshot_request_t *pxshot_wait_any(pxshot_client_t *client, int timeout_ms);
 
-static const char *pxshot_format_string(pxshot_format_t fmt) {
-    switch (fmt) {
-        case PXSHOT_FORMAT_JPEG: return "jpeg";
-        case PXSHOT_FORMAT_WEBP: return "webp";
-        default: return "png";
-    }
-}
+/**
+ * @brief Check whether a request has completed
+ *
+ * @param req Request handle
+ * @return true if the response is ready
+ */
+bool pxshot_request_is_done(const pxshot_request_t *req);
+
+/**
+ * @brief Get the userdata pointer passed to pxshot_submit()
+ *
+ * @param req Request handle
+ * @return Userdata pointer
+ */
+void *pxshot_request_userdata(const pxshot_request_t *req);
+
+/**
+ * @brief Collect the response of a future-style request and release it
+ *
+ * @param req Request handle (invalid after this call)
+ * @return The response, or NULL if the request was still in flight, in
+ *         which case the transfer is aborted
+ *
+ * @note Caller must free the response with pxshot_response_free()
+ */
+pxshot_response_t *pxshot_request_finish(pxshot_request_t *req);
+
+/**
+ * @brief Number of submitted requests not yet handed back to the caller
+ *
+ * @param client Pxshot client
+ * @return Requests in flight plus completed requests awaiting collection
+ */
+size_t pxshot_pending(const pxshot_client_t *client);
+
+/**
+ * @brief Per-item callback for batch captures
+ *
+ * @param index Index of the item in the opts array
+ * @param resp Response for the item (callback takes ownership)
+ * @param userdata Pointer passed to pxshot_screenshot_batch()
+ */
+typedef void (*pxshot_batch_cb)(size_t index, pxshot_response_t *resp, void *userdata);
+
+/**
+ * @brief Capture a list of screenshots with bounded concurrency
+ *
+ * Keeps up to @p concurrency requests in flight on the client's
+ * asynchronous engine and starts the next item as soon as one completes.
+ * Blocks until every item has completed.
+ *
+ * @param client Pxshot client
+ * @param opts Array of screenshot options
+ * @param count Number of items in @p opts
+ * @param concurrency Maximum requests in flight (0 = default 16, or the adaptive
+ *                    concurrency limit's max_limit when that is enabled)
+ * @param on_item Per-item callback, or NULL to fill @p results instead
+ * @param userdata Opaque pointer passed to @p on_item
+ * @param results Array of @p count response pointers, filled in when
+ *                @p on_item is NULL (caller frees each response)
+ * @return PXSHOT_OK once every item has a response, or an error if the
+ *         batch was cut short (items that never ran get no response)
+ *
+ * @note Per-item failures are reported in the item's response, not here.
+ */
+pxshot_error_t pxshot_screenshot_batch(pxshot_client_t *client,
+                                       const pxshot_screenshot_opts_t *opts,
+                                       size_t count,
+                                       size_t concurrency,
+                                       pxshot_batch_cb on_item,
+                                       void *userdata,
+                                       pxshot_response_t **results);
+
+/* ============================================================================
+ * Event Loop Integration
+ *
+ * Lets an existing reactor (epoll, kqueue, libuv, ...) drive the asynchronous
+ * engine instead of pxshot_poll(). The SDK reports which sockets to watch and
+ * when its timer should fire; the loop calls pxshot_loop_on_socket() and
+ * pxshot_loop_on_timeout() when they do. Each call only services the sockets
+ * that are ready, and completion callbacks run inline from those calls.
+ *
+ * While a loop is attached, pxshot_poll() and pxshot_wait_any() no longer
+ * drive transfers; they only hand out completed requests.
+ * pxshot_screenshot_batch() is not available.
+ * ============================================================================ */
+
+/**
+ * @brief Socket readiness flags
+ */
+typedef enum {
+    PXSHOT_POLL_IN = 1,         /**< Watch for / socket is readable */
+    PXSHOT_POLL_OUT = 2,        /**< Watch for / socket is writable */
+    PXSHOT_POLL_ERR = 4,        /**< Socket has an error condition */
+    PXSHOT_POLL_REMOVE = 8      /**< Stop watching the socket */
+} pxshot_poll_event_t;
+
+/**
+ * @brief Socket watch callback
+ *
+ * Called when the set of events to watch on @p fd changes. @p events is a
+ * combination of PXSHOT_POLL_IN and PXSHOT_POLL_OUT, or PXSHOT_POLL_REMOVE.
+ *
+ * @param fd Socket descriptor
+ * @param events Events to watch for
+ * @param userdata Pointer passed to pxshot_loop_attach()
+ */
+typedef void (*pxshot_socket_cb)(int fd, int events, void *userdata);
+
+/**
+ * @brief Timer callback
+ *
+ * Called when the SDK's single timer changes. The loop should call
+ * pxshot_loop_on_timeout() after @p timeout_ms milliseconds, replacing any
+ * earlier deadline. 0 means as soon as possible, -1 cancels the timer.
+ *
+ * @param timeout_ms Delay in milliseconds, or -1
+ * @param userdata Pointer passed to pxshot_loop_attach()
+ */
+typedef void (*pxshot_timer_cb)(long timeout_ms, void *userdata);
+
+/**
+ * @brief Hand the asynchronous engine over to an external event loop
+ *
+ * Pass NULL callbacks to detach and return to pxshot_poll().
+ *
+ * @param client Pxshot client
+ * @param on_socket Socket watch callback
+ * @param on_timer Timer callback
+ * @param userdata Opaque pointer passed to both callbacks
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG if only one callback is given
+ *         or requests are pending
+ *
+ * @note Pending transfers are removed when the client is freed, so the
+ *       callbacks may still run from pxshot_free().
+ */
+pxshot_error_t pxshot_loop_attach(pxshot_client_t *client,
+                                  pxshot_socket_cb on_socket,
+                                  pxshot_timer_cb on_timer,
+                                  void *userdata);
+
+/**
+ * @brief Service a ready socket
+ *
+ * @param client Pxshot client
+ * @param fd Socket reported through the socket callback
+ * @param events PXSHOT_POLL_IN, PXSHOT_POLL_OUT and/or PXSHOT_POLL_ERR
+ * @return Number of requests still in flight, or -1 on error
+ */
+int pxshot_loop_on_socket(pxshot_client_t *client, int fd, int events);
+
+/**
+ * @brief Handle an expired timer
+ *
+ * @param client Pxshot client
+ * @return Number of requests still in flight, or -1 on error
+ */
+int pxshot_loop_on_timeout(pxshot_client_t *client);
+
+/* ============================================================================
+ * Executor
+ *
+ * A pool of worker threads that run blocking captures for callers who do
+ * not want to drive the asynchronous engine. Each worker owns a job deque;
+ * idle workers steal from the others, so a few slow captures do not leave
+ * threads waiting while work is queued elsewhere.
+ * ============================================================================ */
+
+/**
+ * @brief Worker thread pool running captures on a client
+ */
+typedef struct pxshot_executor pxshot_executor_t;
+
+/**
+ * @brief Executor job completion callback
+ *
+ * Runs on the worker thread that performed the capture. The callback takes
+ * ownership of @p resp and must free it with pxshot_response_free().
+ *
+ * @param opts Options the job was submitted with (executor's copy)
+ * @param resp Response (same layout as pxshot_screenshot())
+ * @param userdata Pointer passed to pxshot_executor_submit()
+ */
+typedef void (*pxshot_job_cb)(const pxshot_screenshot_opts_t *opts, pxshot_response_t *resp, void *userdata);
+
+/**
+ * @brief Executor statistics
+ */
+typedef struct {
+    size_t workers;             /**< Worker threads */
+    size_t queued;              /**< Jobs waiting for a worker */
+    uint64_t completed;         /**< Jobs run to completion */
+    uint64_t stolen;            /**< Jobs taken from another worker's deque */
+} pxshot_executor_stats_t;
+
+/**
+ * @brief Start an executor
+ *
+ * Raises the client's pool cap to at least @p workers so every worker can
+ * hold its own CURL handle and connection.
+ *
+ * @param client Pxshot client (must outlive the executor)
+ * @param workers Number of worker threads (0 = default 4)
+ * @return New executor, or NULL on failure
+ */
+pxshot_executor_t *pxshot_executor_new(pxshot_client_t *client, size_t workers);
+
+/**
+ * @brief Queue a capture
+ *
+ * @p opts is copied, but the strings it points to must stay valid until
+ * the job's callback has run.
+ *
+ * @param executor Executor
+ * @param opts Screenshot options
+ * @param on_complete Completion callback (required)
+ * @param userdata Opaque pointer passed to @p on_complete
+ * @return PXSHOT_OK, PXSHOT_ERR_INVALID_ARG or PXSHOT_ERR_OUT_OF_MEMORY
+ */
+pxshot_error_t pxshot_executor_submit(pxshot_executor_t *executor,
+                                      const pxshot_screenshot_opts_t *opts,
+                                      pxshot_job_cb on_complete,
+                                      void *userdata);
+
+/**
+ * @brief Block until every submitted job has completed
+ *
+ * @param executor Executor
+ */
+void pxshot_executor_wait(pxshot_executor_t *executor);
+
+/**
+ * @brief Get executor statistics
+ *
+ * @param executor Executor
+ * @param stats Output parameter for executor statistics
+ * @return PXSHOT_OK, or PXSHOT_ERR_INVALID_ARG if an argument is NULL
+ */
+pxshot_error_t pxshot_executor_get_stats(pxshot_executor_t *executor, pxshot_executor_stats_t *stats);
+
+/**
+ * @brief Stop an executor
+ *
+ * Runs the jobs still queued, then joins the worker threads.
+ * Safe to pass NULL.
+ *
+ * @param executor Executor to free
+ */
+void pxshot_executor_free(pxshot_executor_t *executor);
+
+/* ============================================================================
+ * Memory Management
+ * ============================================================================ */
+
+/**
+ * @brief Free a response structure
+ * 
+ * @param resp Response to free (safe to pass NULL)
+ */
+void pxshot_response_free(pxshot_response_t *resp);
+
+/**
+ * @brief Free a usage structure
+ * 
+ * @param usage Usage to free (safe to pass NULL)
+ */
+void pxshot_usage_free(pxshot_usage_t *usage);
+
+/* ============================================================================
+ * Utilities
+ * ============================================================================ */
+
+/**
+ * @brief Get a human-readable error message for an error code
+ * 
+ * @param error Error code
+ * @return Static string describing the error
+ */
+const char *pxshot_error_string(pxshot_error_t error);
+
+/**
+ * @brief Get the SDK version string
+ * 
+ * @return Version string (e.g., "1.0.0")
+ */
+const char *pxshot_version(void);
+
+/* ============================================================================
+ * Header-Only Implementation (optional)
+ * 
+ * Define PXSHOT_IMPLEMENTATION before including this header in exactly ONE
+ * source file to include the implementation:
+ * 
+ *   #define PXSHOT_IMPLEMENTATION
+ *   #include <pxshot.h>
+ * 
+ * ============================================================================ */
+
+#ifdef PXSHOT_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <math.h>
+#include <limits.h>
+#include <locale.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <curl/curl.h>
+
+/* Allocator */
+
+static void *pxshot_libc_malloc(size_t size, void *ctx) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void *pxshot_libc_realloc(void *ptr, size_t size, void *ctx) {
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static void pxshot_libc_free(void *ptr, void *ctx) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const pxshot_allocator_t pxshot_libc_allocator = {
+    pxshot_libc_malloc, pxshot_libc_realloc, pxshot_libc_free, NULL
+};
+
+static const pxshot_allocator_t *pxshot_global_allocator = &pxshot_libc_allocator;
+
+static void *pxshot_mem_alloc(const pxshot_allocator_t *a, size_t size) {
+    return a->malloc_fn(size ? size : 1, a->ctx);
+}
+
+static void *pxshot_mem_calloc(const pxshot_allocator_t *a, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) return NULL;
+    void *ptr = pxshot_mem_alloc(a, count * size);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+static void *pxshot_mem_realloc(const pxshot_allocator_t *a, void *ptr, size_t size) {
+    return ptr ? a->realloc_fn(ptr, size ? size : 1, a->ctx) : pxshot_mem_alloc(a, size);
+}
+
+static void pxshot_mem_free(const pxshot_allocator_t *a, void *ptr) {
+    if (ptr) a->free_fn(ptr, a->ctx);
+}
+
+/* Shared DNS/TLS/connection state */
+struct pxshot_share {
+    const pxshot_allocator_t *alloc;
+    CURLSH *sh;
+    pthread_mutex_t locks[CURL_LOCK_DATA_LAST];
+    atomic_size_t refs;
+};
+
+/* API endpoint a CURL handle is currently configured for */
+typedef enum {
+    PXSHOT_ENDPOINT_NONE = 0,
+    PXSHOT_ENDPOINT_SCREENSHOT,
+    PXSHOT_ENDPOINT_USAGE
+} pxshot_endpoint_t;
+
+/*
+ * Pooled CURL easy handle with its persistent request context.
+ * Client-wide options are applied once when the handle is created and the
+ * handle is never reset, so keep-alive connections and TLS state survive
+ * between requests; only per-request options are set on each use.
+ */
+typedef struct pxshot_conn {
+    CURL *curl;
+    pxshot_endpoint_t endpoint;     /* URL/headers/method currently set */
+    bool pooled;                    /* Counted in pool->total */
+    bool guarded;                   /* Progress callback and request timeout active */
+    CURLM *multi;                   /* Drives blocking transfers (created on first use) */
+    struct pxshot_conn *next;       /* Idle stack link */
+} pxshot_conn_t;
+
+/*
+ * Pool of CURL easy handles shared by all threads using a client.
+ * Idle handles form a LIFO stack so the most recently used (warmest)
+ * connection is handed out first; the lock is only held for push/pop.
+ */
+typedef struct {
+    const pxshot_allocator_t *alloc;
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    void (*setup)(CURL *curl, void *ctx);   /* Applied to every new handle */
+    void *setup_ctx;
+    pxshot_conn_t *idle;
+    size_t idle_count;
+    size_t total;
+    size_t max;
+    uint64_t checkouts;
+    uint64_t waits;
+    uint64_t wait_ns_total;
+    uint64_t wait_ns_max;
+} pxshot_pool_t;
+
+/* Token bucket refilled per request instead of per second (retry and hedge budgets) */
+typedef struct {
+    atomic_int_fast64_t balance;    /* In PXSHOT_BUDGET_UNIT per token */
+    int64_t cap;
+    int64_t deposit;
+} pxshot_budget_t;
+
+/* Recent request latencies, for the hedging threshold */
+#define PXSHOT_LATENCY_SAMPLES 256
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t samples[PXSHOT_LATENCY_SAMPLES];   /* Ring buffer, milliseconds */
+    size_t count;
+    size_t next;
+    size_t since_update;
+    long threshold_ms;              /* Cached hedge delay, -1 until enough samples */
+} pxshot_latency_t;
+
+/*
+ * Rate limiter: a token bucket in GCRA form, so taking a token is one CAS
+ * on the theoretical arrival time of the next request.
+ */
+typedef struct {
+    atomic_int_fast64_t tat_ns;         /* Next request's theoretical arrival time */
+    atomic_int_fast64_t interval_ns;    /* Time per token (0 = unlimited) */
+    int64_t base_interval_ns;           /* From requests_per_sec (0 = none) */
+    int64_t burst;
+    atomic_bool exhausted;              /* Plan quota used up */
+    atomic_int_fast64_t calibrate_at_ms;
+    atomic_uint_fast64_t delayed;
+    atomic_uint_fast64_t delay_ms;
+    atomic_uint_fast64_t rejected;
+} pxshot_limiter_t;
+
+/* Reference-counted image bytes shared by the responses of coalesced requests */
+typedef struct {
+    atomic_size_t refs;
+    const pxshot_allocator_t *alloc;
+    size_t len;
+    uint8_t data[];                 /* NUL-terminated like pxshot_buffer_t */
+} pxshot_blob_t;
+
+/* Single-flight: one capture in flight per canonical request key */
+#define PXSHOT_FLIGHT_BUCKETS 64
+
+typedef struct pxshot_flight {
+    uint64_t hash;
+    char *key;
+    size_t refs;                    /* Leader plus waiting followers */
+    bool done;
+    bool abandoned;                 /* Leader stopped by its own cancel or deadline */
+    pxshot_response_t *result;      /* Published outcome, once done */
+    struct pxshot_flight *next;
+} pxshot_flight_t;
+
+/* In-memory LRU cache: per-shard hash chains plus an LRU list */
+#define PXSHOT_CACHE_BUCKETS 64
+
+typedef struct pxshot_cache_entry {
+    uint64_t hash;
+    char *key;
+    pxshot_blob_t *blob;
+    size_t charge;                  /* Bytes counted against the budget */
+    uint64_t expires_ms;
+    struct pxshot_cache_entry *chain;
+    struct pxshot_cache_entry *prev; /* LRU list, most recent first */
+    struct pxshot_cache_entry *next;
+} pxshot_cache_entry_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pxshot_cache_entry_t *buckets[PXSHOT_CACHE_BUCKETS];
+    pxshot_cache_entry_t *head;
+    pxshot_cache_entry_t *tail;
+    size_t bytes;
+    size_t entries;
+} pxshot_cache_shard_t;
+
+/* Stored-result reuse: the last store=true result per canonical options */
+#define PXSHOT_STORED_BUCKETS 256
+
+typedef struct pxshot_stored_entry {
+    uint64_t hash;
+    char *key;
+    pxshot_stored_t stored;
+    int64_t expires_ms;             /* expires_at on the wall clock */
+    struct pxshot_stored_entry *chain;
+    struct pxshot_stored_entry *prev; /* LRU list, most recent first */
+    struct pxshot_stored_entry *next;
+    char text[];                    /* key, url and expires_at */
+} pxshot_stored_entry_t;
+
+/*
+ * Response buffer pool. Class c holds idle buffers of at least 2^c bytes,
+ * linked through their first bytes. Responses owning a pooled buffer keep
+ * a reference, so buffers freed after the client still find their way home.
+ */
+#define PXSHOT_BUFPOOL_MIN_SHIFT 12
+#define PXSHOT_BUFPOOL_CLASSES 20       /* 4 KiB .. 2 GiB */
+
+typedef struct pxshot_bufpool_idle {
+    struct pxshot_bufpool_idle *next;
+    size_t cap;
+} pxshot_bufpool_idle_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pxshot_bufpool_idle_t *head;
+    size_t count;
+} pxshot_bufpool_class_t;
+
+typedef struct {
+    atomic_size_t refs;             /* Client plus responses holding a buffer */
+    const pxshot_allocator_t *alloc;
+    size_t max_bytes;
+    atomic_size_t idle_bytes;
+    atomic_bool closed;             /* Client freed: stop keeping buffers */
+    pxshot_bufpool_class_t classes[PXSHOT_BUFPOOL_CLASSES];
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t misses;
+    atomic_uint_fast64_t recycled;
+    atomic_uint_fast64_t dropped;
+} pxshot_bufpool_t;
+
+/*
+ * Disk cache: images live in <dir>/objects/<xx>/<content hash>, and the
+ * options-hash -> content-hash index is kept in memory and journaled to
+ * <dir>/index, which is compacted as it grows and on pxshot_free().
+ */
+#define PXSHOT_DISK_BUCKETS 4096
+#define PXSHOT_DISK_PATH_MAX 4096
+#define PXSHOT_DISK_MAGIC "PXSHDC1\n"
+
+typedef struct pxshot_disk_object {
+    uint64_t id[2];                 /* Hash of the image bytes */
+    uint64_t size;
+    size_t refs;                    /* Index entries naming this image */
+    bool missing;                   /* File absent or truncated (checked on load) */
+    struct pxshot_disk_object *chain;
+} pxshot_disk_object_t;
+
+typedef struct pxshot_disk_entry {
+    uint64_t key[2];                /* Hash of the canonical options */
+    pxshot_disk_object_t *object;
+    int64_t created_ms;             /* Wall clock, so the TTL holds across restarts */
+    int64_t used_ms;
+    struct pxshot_disk_entry *chain;
+    struct pxshot_disk_entry *prev; /* LRU list, most recent first */
+    struct pxshot_disk_entry *next;
+} pxshot_disk_entry_t;
+
+/* Journal record; an all-zero id removes the key */
+typedef struct {
+    uint64_t key[2];
+    uint64_t id[2];
+    uint64_t size;
+    int64_t created_ms;
+    int64_t used_ms;
+} pxshot_disk_record_t;
+
+typedef struct {
+    const pxshot_allocator_t *alloc;
+    pthread_mutex_t lock;
+    char *dir;
+    int lock_fd;                    /* flock()ed while the client uses the directory */
+    FILE *journal;                  /* <dir>/index, opened for append */
+    size_t journal_records;
+    pxshot_disk_entry_t *entries[PXSHOT_DISK_BUCKETS];
+    pxshot_disk_object_t *objects[PXSHOT_DISK_BUCKETS];
+    size_t entry_count;
+    size_t object_count;
+    pxshot_disk_entry_t *head;
+    pxshot_disk_entry_t *tail;
+    uint64_t bytes;                 /* Size of all image files */
+} pxshot_disk_t;
+
+/* Adaptive concurrency limit (gradient); driven from the async thread only */
+typedef struct {
+    double limit;
+    double rtt_short;               /* EMA over ~10 samples */
+    double rtt_long;                /* EMA over ~600 samples */
+    uint64_t samples;
+    uint64_t backoffs;
+} pxshot_climit_t;
+
+/* Per-endpoint circuit breaker with a bucketed rolling window */
+#define PXSHOT_BREAKER_BUCKETS 10
+
+typedef enum {
+    PXSHOT_OUTCOME_SUCCESS,
+    PXSHOT_OUTCOME_FAILURE,
+    PXSHOT_OUTCOME_NEUTRAL          /* Not sent to completion (cancelled, deadline) */
+} pxshot_outcome_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pxshot_circuit_state_t state;
+    struct {
+        uint64_t start_ms;
+        uint32_t requests;
+        uint32_t failures;
+    } buckets[PXSHOT_BREAKER_BUCKETS];
+    uint64_t opened_ms;
+    int probes_inflight;
+    int probe_successes;
+    uint64_t rejected;
+    uint64_t opened;
+} pxshot_breaker_t;
+
+/* Internal client structure */
+struct pxshot_client {
+    const pxshot_allocator_t *alloc;
+    char *api_key;
+    char *base_url;
+    long timeout_ms;
+    bool http2;
+    char *ca_file;
+    pxshot_share_t *share;
+
+    /* Request context shared by every handle, built once */
+    char *screenshot_url;
+    char *usage_url;
+    struct curl_slist *json_headers;    /* Authorization + Content-Type */
+    struct curl_slist *auth_headers;    /* Authorization only */
+
+    pxshot_pool_t pool;
+    bool pool_ready;
+
+    /* Asynchronous engine */
+    CURLM *multi;
+    pxshot_request_t *inflight;     /* Running or deferred requests (FIFO) */
+    pxshot_request_t *inflight_tail;
+    pxshot_request_t *cb_head;      /* Completed, callback not yet run (FIFO) */
+    pxshot_request_t *cb_tail;
+    pxshot_request_t *done_head;    /* Completed futures awaiting collection (FIFO) */
+    pxshot_request_t *done_tail;
+    size_t inflight_count;
+    size_t done_count;
+    size_t guarded_inflight;        /* In-flight requests with a cancel token or deadline */
+
+    /* External event loop, if attached */
+    pxshot_socket_cb loop_socket;
+    pxshot_timer_cb loop_timer;
+    void *loop_userdata;
+    bool loop_kicked;               /* Timer forced to 0 for completions queued by submit */
+
+    /* Transport statistics, updated from any thread */
+    atomic_uint_fast64_t stat_requests;
+    atomic_uint_fast64_t stat_connections;
+    atomic_uint_fast64_t stat_http2_streams;
+    atomic_uint_fast64_t stat_http2_multiplexed;
+    atomic_uint_fast64_t stat_retries;
+    atomic_uint_fast64_t stat_retries_throttled;
+
+    /* Retry policy (defaults applied) and client-wide retry budget */
+    pxshot_retry_policy_t retry;
+    pxshot_budget_t retry_budget;
+    atomic_uint_fast64_t rng_state;     /* Backoff jitter */
+
+    /* Hedging policy (defaults applied), budget and latency history */
+    pxshot_hedge_policy_t hedge;
+    pxshot_budget_t hedge_budget;
+    pxshot_latency_t latency;
+    atomic_uint_fast64_t stat_hedges;
+    atomic_uint_fast64_t stat_hedges_throttled;
+    atomic_uint_fast64_t stat_hedge_wins;
+    atomic_uint_fast64_t stat_hedge_saved_ms;
+
+    /* Circuit breakers, indexed by pxshot_api_t */
+    pxshot_circuit_policy_t circuit;
+    pxshot_breaker_t breakers[PXSHOT_API_USAGE + 1];
+
+    /* Rate limit */
+    pxshot_rate_limit_t rate_limit;
+    pxshot_limiter_t limiter;
+    size_t deferred_count;          /* In-flight requests waiting to start */
+
+    /* Adaptive concurrency */
+    pxshot_concurrency_policy_t concurrency;
+    pxshot_climit_t climit;
+
+    /* Request coalescing */
+    bool coalesce;
+    pthread_mutex_t flight_lock;
+    pthread_cond_t flight_landed;
+    pxshot_flight_t *flights[PXSHOT_FLIGHT_BUCKETS];
+    atomic_uint_fast64_t stat_coalesced;
+
+    /* In-memory cache (shards == NULL when disabled) */
+    pxshot_cache_policy_t cache;
+    pxshot_cache_shard_t *cache_shards;
+    size_t cache_shard_bytes;       /* Budget of each shard */
+    atomic_uint_fast64_t stat_cache_hits;
+    atomic_uint_fast64_t stat_cache_misses;
+    atomic_uint_fast64_t stat_cache_evictions;
+    atomic_uint_fast64_t stat_cache_expirations;
+
+    /* Disk cache (NULL when disabled) */
+    pxshot_disk_cache_policy_t disk_cache;
+    pxshot_disk_t *disk;
+    pxshot_bufpool_t *bufpool;      /* Response buffer pool (NULL = off) */
+    atomic_uint_fast64_t stat_disk_hits;
+    atomic_uint_fast64_t stat_disk_misses;
+    atomic_uint_fast64_t stat_disk_evictions;
+    atomic_uint_fast64_t stat_disk_expirations;
+
+    /* Stored-result reuse */
+    pxshot_stored_reuse_t stored_reuse;
+    pthread_mutex_t stored_lock;
+    pxshot_stored_entry_t *stored_buckets[PXSHOT_STORED_BUCKETS];
+    pxshot_stored_entry_t *stored_head;
+    pxshot_stored_entry_t *stored_tail;
+    size_t stored_count;
+    atomic_uint_fast64_t stat_stored_hits;
+};
+
+/* Cancellation token */
+struct pxshot_cancel {
+    const pxshot_allocator_t *alloc;
+    atomic_bool triggered;
+};
+
+/* Per-request cancellation state, checked from the progress callback */
+typedef struct {
+    const pxshot_cancel_t *cancel;
+    uint64_t deadline_ms;           /* Absolute, pxshot_now_ms() clock; 0 = none */
+    pxshot_error_t reason;          /* Why the transfer was aborted */
+    bool deadline_bound;            /* Transfer timeout was cut down to the deadline */
+} pxshot_guard_t;
+
+/* CURL write callback data */
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    const pxshot_sink_t *sink;      /* Stream 2xx bodies here instead (NULL = buffer everything) */
+    CURL *curl;                     /* Transfer, for its status once a sink is set */
+    long status;                    /* Response status, read at the first body chunk */
+    size_t streamed;                /* Bytes written to the sink */
+    bool sink_failed;
+    size_t expected;                /* Content-Length of the response (0 = unknown) */
+    uint32_t reallocs;              /* Growths after the first allocation */
+    const pxshot_allocator_t *alloc; /* Owner of data, set with the write callback */
+    pxshot_bufpool_t *pool;         /* Source of the first allocation (NULL = none) */
+} pxshot_buffer_t;
+
+/* Request bodies up to this size are built without allocating */
+#define PXSHOT_BODY_INLINE 512
+
+/* Internal asynchronous request structure */
+struct pxshot_request {
+    pxshot_client_t *client;        /* NULL once pxshot_wait_any() has handed the request out */
+    const pxshot_allocator_t *alloc; /* Owner of the request; outlives the client link */
+    pxshot_conn_t *conn;
+    char *body;                     /* body_inline, or the heap when it did not fit */
+    char body_inline[PXSHOT_BODY_INLINE];
+    pxshot_buffer_t buffer;
+    bool store;
+    bool done;
+    bool guarded;                   /* Counted in client->guarded_inflight */
+    bool admitted;                  /* Outcome still owed to the circuit breaker */
+    bool probe;                     /* Admitted as a half-open probe */
+    bool deferred;                  /* Linked in-flight but not started; see start_at_ms */
+    bool multiplexed;               /* Shared its HTTP/2 connection with another transfer */
+    uint64_t start_at_ms;
+    uint64_t start_ms;
+    char *cache_key;                /* Cache a successful image under this key */
+    uint64_t cache_hash;
+    pxshot_guard_t guard;
+    pxshot_response_t *response;
+    pxshot_request_cb on_complete;
+    void *userdata;
+    pxshot_request_t *prev;         /* Links in the in-flight list or a done queue */
+    pxshot_request_t *next;
+    size_t index;                   /* Item index for batch requests */
+};
+
+/* Response buffer pool */
+
+static pxshot_bufpool_t *pxshot_bufpool_new(const pxshot_allocator_t *alloc, size_t max_bytes) {
+    pxshot_bufpool_t *pool = (pxshot_bufpool_t *)pxshot_mem_calloc(alloc, 1, sizeof(pxshot_bufpool_t));
+    if (!pool) return NULL;
+    atomic_init(&pool->refs, 1);
+    pool->alloc = alloc;
+    pool->max_bytes = max_bytes;
+    for (int i = 0; i < PXSHOT_BUFPOOL_CLASSES; i++) pthread_mutex_init(&pool->classes[i].lock, NULL);
+    return pool;
+}
+
+static pxshot_bufpool_t *pxshot_bufpool_retain(pxshot_bufpool_t *pool) {
+    atomic_fetch_add_explicit(&pool->refs, 1, memory_order_relaxed);
+    return pool;
+}
+
+/* Free every idle buffer */
+static void pxshot_bufpool_drain(pxshot_bufpool_t *pool) {
+    for (int i = 0; i < PXSHOT_BUFPOOL_CLASSES; i++) {
+        pxshot_bufpool_class_t *cls = &pool->classes[i];
+        pthread_mutex_lock(&cls->lock);
+        pxshot_bufpool_idle_t *idle = cls->head;
+        cls->head = NULL;
+        cls->count = 0;
+        pthread_mutex_unlock(&cls->lock);
+        while (idle) {
+            pxshot_bufpool_idle_t *next = idle->next;
+            atomic_fetch_sub_explicit(&pool->idle_bytes, idle->cap, memory_order_relaxed);
+            pxshot_mem_free(pool->alloc, idle);
+            idle = next;
+        }
+    }
+}
+
+static void pxshot_bufpool_release(pxshot_bufpool_t *pool) {
+    if (!pool || atomic_fetch_sub_explicit(&pool->refs, 1, memory_order_acq_rel) != 1) return;
+    pxshot_bufpool_drain(pool);
+    for (int i = 0; i < PXSHOT_BUFPOOL_CLASSES; i++) pthread_mutex_destroy(&pool->classes[i].lock);
+    pxshot_mem_free(pool->alloc, pool);
+}
+
+/* Smallest class whose buffers all hold size bytes (PXSHOT_BUFPOOL_CLASSES if none) */
+static int pxshot_bufpool_class_for(size_t size) {
+    int c = PXSHOT_BUFPOOL_MIN_SHIFT;
+    while (c < PXSHOT_BUFPOOL_MIN_SHIFT + PXSHOT_BUFPOOL_CLASSES && ((size_t)1 << c) < size) c++;
+    return c - PXSHOT_BUFPOOL_MIN_SHIFT;
+}
+
+/* Buffer of at least size bytes; *cap receives its real capacity */
+static uint8_t *pxshot_bufpool_get(pxshot_bufpool_t *pool, size_t size, size_t *cap) {
+    int c = pxshot_bufpool_class_for(size);
+    if (c == PXSHOT_BUFPOOL_CLASSES) {
+        *cap = size;
+        return (uint8_t *)pxshot_mem_alloc(pool->alloc, size);
+    }
+
+    pxshot_bufpool_class_t *cls = &pool->classes[c];
+    pthread_mutex_lock(&cls->lock);
+    pxshot_bufpool_idle_t *idle = cls->head;
+    if (idle) {
+        cls->head = idle->next;
+        cls->count--;
+    }
+    pthread_mutex_unlock(&cls->lock);
+
+    if (idle) {
+        *cap = idle->cap;
+        atomic_fetch_sub_explicit(&pool->idle_bytes, idle->cap, memory_order_relaxed);
+        atomic_fetch_add_explicit(&pool->hits, 1, memory_order_relaxed);
+        return (uint8_t *)idle;
+    }
+    atomic_fetch_add_explicit(&pool->misses, 1, memory_order_relaxed);
+    *cap = (size_t)1 << (c + PXSHOT_BUFPOOL_MIN_SHIFT);
+    return (uint8_t *)pxshot_mem_alloc(pool->alloc, *cap);
+}
+
+/* Take a buffer back, or free it if the pool is full or closed */
+static void pxshot_bufpool_put(pxshot_bufpool_t *pool, uint8_t *data, size_t cap) {
+    if (!data) return;
+    /* Largest class the buffer fully covers */
+    int c = pxshot_bufpool_class_for(cap);
+    if (c < PXSHOT_BUFPOOL_CLASSES && ((size_t)1 << (c + PXSHOT_BUFPOOL_MIN_SHIFT)) > cap) c--;
+    bool keep = c >= 0 && c < PXSHOT_BUFPOOL_CLASSES && !atomic_load(&pool->closed);
+    if (keep && atomic_fetch_add_explicit(&pool->idle_bytes, cap, memory_order_relaxed) + cap > pool->max_bytes) {
+        atomic_fetch_sub_explicit(&pool->idle_bytes, cap, memory_order_relaxed);
+        atomic_fetch_add_explicit(&pool->dropped, 1, memory_order_relaxed);
+        keep = false;
+    }
+    if (!keep) {
+        pxshot_mem_free(pool->alloc, data);
+        return;
+    }
+
+    pxshot_bufpool_idle_t *idle = (pxshot_bufpool_idle_t *)data;
+    idle->cap = cap;
+    pxshot_bufpool_class_t *cls = &pool->classes[c];
+    pthread_mutex_lock(&cls->lock);
+    idle->next = cls->head;
+    cls->head = idle;
+    cls->count++;
+    pthread_mutex_unlock(&cls->lock);
+    atomic_fetch_add_explicit(&pool->recycled, 1, memory_order_relaxed);
+}
+
+/* Release a transfer buffer's memory that no response took over */
+static void pxshot_buffer_free(pxshot_buffer_t *buf) {
+    if (!buf->data) return;
+    if (buf->pool) pxshot_bufpool_put(buf->pool, buf->data, buf->cap);
+    else pxshot_mem_free(buf->alloc, buf->data);
+    buf->data = NULL;
+}
+
+/* Write all of data to a sink; false if it took less */
+static bool pxshot_sink_write(const pxshot_sink_t *sink, const uint8_t *data, size_t len) {
+    switch (sink->type) {
+        case PXSHOT_SINK_CALLBACK:
+            return sink->write(data, len, sink->userdata) == len;
+        case PXSHOT_SINK_FD:
+            while (len > 0) {
+                ssize_t n = write(sink->fd, data, len);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                data += n;
+                len -= (size_t)n;
+            }
+            return true;
+        case PXSHOT_SINK_FILE:
+            return fwrite(data, 1, len, sink->file) == len;
+    }
+    return false;
+}
+
+/* Internal helpers */
+static size_t pxshot_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    pxshot_buffer_t *buf = (pxshot_buffer_t *)userp;
+
+    if (buf->sink) {
+        if (!buf->status) curl_easy_getinfo(buf->curl, CURLINFO_RESPONSE_CODE, &buf->status);
+        if (buf->status >= 200 && buf->status < 300) {
+            if (!pxshot_sink_write(buf->sink, (const uint8_t *)contents, realsize)) {
+                buf->sink_failed = true;
+                return 0;
+            }
+            buf->streamed += realsize;
+            return realsize;
+        }
+    }
+
+    if (realsize > SIZE_MAX - buf->len - 1) return 0;
+    size_t need = buf->len + realsize + 1;
+    if (need > buf->cap) {
+        /*
+         * Allocate the announced length exactly (or take a pooled buffer that
+         * holds it); grow geometrically past it or without one
+         */
+        uint8_t *newdata = NULL;
+        size_t newcap = buf->expected + 1;
+        if (buf->cap == 0 && buf->pool) {
+            newdata = pxshot_bufpool_get(buf->pool, newcap > need ? newcap : need, &newcap);
+            if (newdata && newcap < need) {
+                pxshot_bufpool_put(buf->pool, newdata, newcap);
+                newdata = NULL;
+            }
+        } else if (buf->cap == 0 && newcap >= need) {
+            newdata = (uint8_t *)pxshot_mem_alloc(buf->alloc, newcap);
+        }
+        if (!newdata) {
+            newcap = (buf->cap == 0) ? 4096 : buf->cap;
+            while (newcap < need) {
+                if (newcap > SIZE_MAX / 2) return 0;
+                newcap *= 2;
+            }
+            if (buf->pool) {
+                /* Move up a class so the smaller buffer goes back for reuse */
+                newdata = pxshot_bufpool_get(buf->pool, newcap, &newcap);
+                if (!newdata) return 0;
+                if (newcap < need) {
+                    pxshot_bufpool_put(buf->pool, newdata, newcap);
+                    return 0;
+                }
+                if (buf->data) memcpy(newdata, buf->data, buf->len);
+                pxshot_bufpool_put(buf->pool, buf->data, buf->cap);
+            } else {
+                newdata = (uint8_t *)pxshot_mem_realloc(buf->alloc, buf->data, newcap);
+                if (!newdata) return 0;
+            }
+            if (buf->cap) buf->reallocs++;
+        }
+        buf->data = newdata;
+        buf->cap = newcap;
+    }
+
+    /* Whatever sized the buffer, never copy past it */
+    if (need > buf->cap) return 0;
+    memcpy(buf->data + buf->len, contents, realsize);
+    buf->len += realsize;
+    buf->data[buf->len] = 0;
+    return realsize;
+}
+
+/*
+ * Largest body buffer allocated up front from Content-Length. The header
+ * comes from the server, so bigger announced bodies grow as bytes arrive.
+ */
+#define PXSHOT_PRESIZE_MAX ((size_t)64 << 20)
+
+/* Header callback: note Content-Length so the body buffer can be sized once */
+static size_t pxshot_header_callback(char *line, size_t size, size_t nitems, void *userp) {
+    size_t len = size * nitems;
+    pxshot_buffer_t *buf = (pxshot_buffer_t *)userp;
+    if (len >= 5 && curl_strnequal(line, "HTTP/", 5)) {
+        /* Status line of a new response, e.g. after 100 Continue */
+        buf->expected = 0;
+    } else if (len > 15 && curl_strnequal(line, "Content-Length:", 15)) {
+        /*
+         * Trust only a plain, in-range number. The buffer and its NUL stay
+         * within PXSHOT_PRESIZE_MAX, a power of two, so a pool class never
+         * rounds it up past the cap.
+         */
+        const char *p = line + 15, *end = line + len;
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p < end && *p >= '0' && *p <= '9') {
+            errno = 0;
+            unsigned long long n = strtoull(p, NULL, 10);
+            if (errno != ERANGE) buf->expected = n < PXSHOT_PRESIZE_MAX ? (size_t)n : PXSHOT_PRESIZE_MAX - 1;
+        }
+    }
+    return len;
+}
+
+static char *pxshot_strdup(const pxshot_allocator_t *a, const char *s) {
+    if (!s) return NULL;
+    size_t len = strlen(s);
+    char *dup = (char *)pxshot_mem_alloc(a, len + 1);
+    if (dup) memcpy(dup, s, len + 1);
+    return dup;
+}
+
+/* Inline space for a response's strings; longer ones spill to the heap */
+#define PXSHOT_RESPONSE_TEXT 256
+
+/*
+ * Response with its private state; pxshot_response_t is the first member.
+ * pub.stored and the strings normally live inside the same allocation.
+ */
+typedef struct {
+    pxshot_response_t pub;
+    const pxshot_allocator_t *alloc; /* Owner of the response and everything it points to */
+    pxshot_blob_t *blob;            /* Owner of pub.data when shared, else NULL */
+    void *map;                      /* pub.data when mapped from the disk cache, else NULL */
+    size_t map_len;
+    pxshot_bufpool_t *pool;         /* Home of pub.data when it is a pooled buffer, else NULL */
+    size_t cap;                     /* Capacity of the pooled buffer */
+    pxshot_stored_t stored;         /* pub.stored points here when set */
+    size_t text_len;                /* Bytes of text in use */
+    char text[PXSHOT_RESPONSE_TEXT];
+} pxshot_response_impl_t;
+
+/* New response using the client's allocator, or the global one without a client */
+static pxshot_response_t *pxshot_response_new(const pxshot_client_t *client) {
+    const pxshot_allocator_t *a = client ? client->alloc : pxshot_global_allocator;
+    pxshot_response_impl_t *impl = (pxshot_response_impl_t *)pxshot_mem_calloc(a, 1, sizeof(pxshot_response_impl_t));
+    if (!impl) return NULL;
+    impl->alloc = a;
+    return &impl->pub;
+}
+
+/* Usage with the allocator that owns it, followed by its strings in one block */
+typedef struct {
+    pxshot_usage_t pub;
+    const pxshot_allocator_t *alloc;
+    char text[];
+} pxshot_usage_impl_t;
+
+static const pxshot_allocator_t *pxshot_response_alloc(const pxshot_response_t *resp) {
+    return ((const pxshot_response_impl_t *)resp)->alloc;
+}
+
+/* Room for a string of up to len bytes in the response's inline text, or the heap once it is full */
+static char *pxshot_response_reserve(pxshot_response_t *resp, size_t len) {
+    pxshot_response_impl_t *impl = (pxshot_response_impl_t *)resp;
+    if (len < PXSHOT_RESPONSE_TEXT - impl->text_len) {
+        char *dup = impl->text + impl->text_len;
+        impl->text_len += len + 1;
+        return dup;
+    }
+    return (char *)pxshot_mem_alloc(impl->alloc, len + 1);
+}
+
+/* Copy len bytes of s into the response */
+static char *pxshot_response_strndup(pxshot_response_t *resp, const char *s, size_t len) {
+    char *dup = pxshot_response_reserve(resp, len);
+    if (!dup) return NULL;
+    memcpy(dup, s, len);
+    dup[len] = 0;
+    return dup;
+}
+
+static char *pxshot_response_strdup(pxshot_response_t *resp, const char *s) {
+    return s ? pxshot_response_strndup(resp, s, strlen(s)) : NULL;
+}
+
+/* Free a response string unless it is inline */
+static void pxshot_response_strfree(pxshot_response_t *resp, char *s) {
+    pxshot_response_impl_t *impl = (pxshot_response_impl_t *)resp;
+    uintptr_t p = (uintptr_t)s, text = (uintptr_t)impl->text;
+    if (s && (p < text || p >= text + PXSHOT_RESPONSE_TEXT)) pxshot_mem_free(impl->alloc, s);
+}
+
+/* Point resp->stored at the response's own zeroed stored struct */
+static pxshot_stored_t *pxshot_response_stored(pxshot_response_t *resp) {
+    pxshot_response_impl_t *impl = (pxshot_response_impl_t *)resp;
+    memset(&impl->stored, 0, sizeof(impl->stored));
+    resp->stored = &impl->stored;
+    return resp->stored;
+}
+
+/* Copy a stored result into resp; false if a string could not be allocated */
+static bool pxshot_response_set_stored(pxshot_response_t *resp, const pxshot_stored_t *from) {
+    pxshot_stored_t *to = pxshot_response_stored(resp);
+    *to = *from;
+    to->url = pxshot_response_strdup(resp, from->url);
+    to->expires_at = pxshot_response_strdup(resp, from->expires_at);
+    return (!from->url || to->url) && (!from->expires_at || to->expires_at);
+}
+
+static pxshot_blob_t *pxshot_blob_new(const pxshot_allocator_t *a, const uint8_t *data, size_t len) {
+    pxshot_blob_t *blob = (pxshot_blob_t *)pxshot_mem_alloc(a, sizeof(pxshot_blob_t) + len + 1);
+    if (!blob) return NULL;
+    atomic_init(&blob->refs, 1);
+    blob->alloc = a;
+    blob->len = len;
+    memcpy(blob->data, data, len);
+    blob->data[len] = 0;
+    return blob;
+}
+
+static pxshot_blob_t *pxshot_blob_retain(pxshot_blob_t *blob) {
+    atomic_fetch_add_explicit(&blob->refs, 1, memory_order_relaxed);
+    return blob;
+}
+
+static void pxshot_blob_release(pxshot_blob_t *blob) {
+    if (blob && atomic_fetch_sub_explicit(&blob->refs, 1, memory_order_acq_rel) == 1) {
+        pxshot_mem_free(blob->alloc, blob);
+    }
+}
+
+/* Point a response's data at a shared blob, taking a reference */
+static void pxshot_response_attach(pxshot_response_t *resp, pxshot_blob_t *blob) {
+    ((pxshot_response_impl_t *)resp)->blob = pxshot_blob_retain(blob);
+    resp->data = blob->data;
+    resp->data_len = blob->len;
+}
+
+static void pxshot_response_drop_data(pxshot_response_t *resp) {
+    pxshot_response_impl_t *impl = (pxshot_response_impl_t *)resp;
+    if (impl->blob) {
+        pxshot_blob_release(impl->blob);
+        impl->blob = NULL;
+    } else if (impl->map) {
+        munmap(impl->map, impl->map_len);
+        impl->map = NULL;
+    } else if (impl->pool) {
+        pxshot_bufpool_put(impl->pool, resp->data, impl->cap);
+        pxshot_bufpool_release(impl->pool);
+        impl->pool = NULL;
+    } else {
+        pxshot_mem_free(impl->alloc, resp->data);
+    }
+}
+
+/* Move a response's own data into a blob so other responses can share it */
+static pxshot_blob_t *pxshot_response_share(pxshot_response_t *resp) {
+    pxshot_response_impl_t *impl = (pxshot_response_impl_t *)resp;
+    if (!impl->blob && resp->data) {
+        pxshot_blob_t *blob = pxshot_blob_new(impl->alloc, resp->data, resp->data_len);
+        if (!blob) return NULL;
+        pxshot_response_drop_data(resp);
+        impl->blob = blob;
+        resp->data = blob->data;
+    }
+    return impl->blob;
+}
+
+
+static void pxshot_set_error(pxshot_response_t *resp, pxshot_error_t err, const char *msg) {
+    resp->error = err;
+    if (msg) resp->error_message = pxshot_response_strdup(resp, msg);
+}
+
+/* Free what the response points to outside its own allocation */
+static void pxshot_response_release(pxshot_response_t *resp) {
+    pxshot_response_strfree(resp, resp->error_message);
+    pxshot_response_drop_data(resp);
+    if (resp->stored) {
+        pxshot_response_strfree(resp, resp->stored->url);
+        pxshot_response_strfree(resp, resp->stored->expires_at);
+    }
+    ((pxshot_response_impl_t *)resp)->text_len = 0;
+}
+
+/* Drop the outcome of a failed attempt, keeping the delivery counters */
+static void pxshot_response_clear(pxshot_response_t *resp) {
+    pxshot_response_release(resp);
+    resp->error = PXSHOT_OK;
+    resp->http_status = 0;
+    resp->error_message = NULL;
+    resp->data = NULL;
+    resp->data_len = 0;
+    resp->stored = NULL;
+    resp->retryable = false;
+}
+
+static const char *pxshot_format_string(pxshot_format_t fmt) {
+    switch (fmt) {
+        case PXSHOT_FORMAT_JPEG: return "jpeg";
+        case PXSHOT_FORMAT_WEBP: return "webp";
+        default: return "png";
+    }
+}
 
 static const char *pxshot_wait_until_string(pxshot_wait_until_t w) {
     switch (w) {
@@ -352,334 +2050,3914 @@ static const char *pxshot_wait_until_string(pxshot_wait_until_t w) {
     }
 }
 
-/* Public API Implementation */
+/* Monotonic clock in nanoseconds */
+static uint64_t pxshot_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Monotonic clock in milliseconds */
+static int64_t pxshot_clock_ms(void) {
+    return (int64_t)(pxshot_clock_ns() / 1000000u);
+}
+
+/* Fill a guard from request options */
+static void pxshot_guard_init(pxshot_guard_t *guard, const pxshot_screenshot_opts_t *opts) {
+    guard->cancel = opts->cancel;
+    guard->deadline_ms = opts->deadline_ms;
+    guard->reason = PXSHOT_OK;
+    guard->deadline_bound = false;
+}
+
+/* PXSHOT_ERR_CANCELLED or PXSHOT_ERR_DEADLINE once the request must stop */
+static pxshot_error_t pxshot_guard_check(const pxshot_guard_t *guard) {
+    if (guard->cancel && atomic_load(&guard->cancel->triggered)) return PXSHOT_ERR_CANCELLED;
+    if (guard->deadline_ms && (uint64_t)pxshot_clock_ms() >= guard->deadline_ms) return PXSHOT_ERR_DEADLINE;
+    return PXSHOT_OK;
+}
+
+static const char *pxshot_guard_message(pxshot_error_t reason) {
+    return reason == PXSHOT_ERR_CANCELLED ? "request cancelled" : "request deadline exceeded";
+}
+
+/* Longest wait between guard checks while a guarded request is running */
+#define PXSHOT_GUARD_POLL_MS 50
+
+/* Budget fixed-point scale (one retry or hedge) */
+#define PXSHOT_BUDGET_UNIT 1000
+
+static void pxshot_budget_init(pxshot_budget_t *budget, double per_request, int max) {
+    budget->cap = (int64_t)max * PXSHOT_BUDGET_UNIT;
+    budget->deposit = (int64_t)(per_request * PXSHOT_BUDGET_UNIT);
+    atomic_init(&budget->balance, budget->cap);
+}
+
+static void pxshot_budget_deposit(pxshot_budget_t *budget) {
+    int64_t cur = atomic_load(&budget->balance);
+    while (cur < budget->cap) {
+        int64_t next = cur + budget->deposit < budget->cap ? cur + budget->deposit : budget->cap;
+        if (atomic_compare_exchange_weak(&budget->balance, &cur, next)) break;
+    }
+}
+
+static bool pxshot_budget_withdraw(pxshot_budget_t *budget) {
+    int64_t cur = atomic_load(&budget->balance);
+    while (cur >= PXSHOT_BUDGET_UNIT) {
+        if (atomic_compare_exchange_weak(&budget->balance, &cur, cur - PXSHOT_BUDGET_UNIT)) return true;
+    }
+    return false;
+}
+
+static bool pxshot_guard_active(const pxshot_guard_t *guard) {
+    return guard && (guard->cancel || guard->deadline_ms);
+}
+
+/* Progress callback: abort the transfer once its guard trips */
+static int pxshot_xferinfo_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                    curl_off_t ultotal, curl_off_t ulnow) {
+    (void)dltotal;
+    (void)dlnow;
+    (void)ultotal;
+    (void)ulnow;
+    pxshot_guard_t *guard = (pxshot_guard_t *)clientp;
+    guard->reason = pxshot_guard_check(guard);
+    return guard->reason != PXSHOT_OK;
+}
+
+/* One-time libcurl initialisation (curl_global_init is not thread-safe) */
+static pthread_once_t pxshot_global_once = PTHREAD_ONCE_INIT;
+
+static void pxshot_global_init(void) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+}
+
+pxshot_error_t pxshot_set_allocator(const pxshot_allocator_t *allocator) {
+    if (!allocator) allocator = &pxshot_libc_allocator;
+    if (!allocator->malloc_fn || !allocator->realloc_fn || !allocator->free_fn) return PXSHOT_ERR_INVALID_ARG;
+    pxshot_global_allocator = allocator;
+    return PXSHOT_OK;
+}
+
+/* Shared state */
+
+static void pxshot_share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+    (void)handle;
+    (void)access;
+    pxshot_share_t *share = (pxshot_share_t *)userptr;
+    pthread_mutex_lock(&share->locks[data]);
+}
+
+static void pxshot_share_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    (void)handle;
+    pxshot_share_t *share = (pxshot_share_t *)userptr;
+    pthread_mutex_unlock(&share->locks[data]);
+}
+
+static pxshot_share_t *pxshot_share_retain(pxshot_share_t *share) {
+    if (share) atomic_fetch_add(&share->refs, 1);
+    return share;
+}
+
+pxshot_share_t *pxshot_share_new(void) {
+    pthread_once(&pxshot_global_once, pxshot_global_init);
+
+    const pxshot_allocator_t *a = pxshot_global_allocator;
+    pxshot_share_t *share = (pxshot_share_t *)pxshot_mem_calloc(a, 1, sizeof(pxshot_share_t));
+    if (!share) return NULL;
+    share->alloc = a;
+
+    share->sh = curl_share_init();
+    if (!share->sh) {
+        pxshot_mem_free(a, share);
+        return NULL;
+    }
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&share->locks[i], NULL);
+    }
+    atomic_init(&share->refs, 1);
+
+    curl_share_setopt(share->sh, CURLSHOPT_LOCKFUNC, pxshot_share_lock);
+    curl_share_setopt(share->sh, CURLSHOPT_UNLOCKFUNC, pxshot_share_unlock);
+    curl_share_setopt(share->sh, CURLSHOPT_USERDATA, share);
+    curl_share_setopt(share->sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share->sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share->sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    return share;
+}
+
+void pxshot_share_free(pxshot_share_t *share) {
+    if (!share) return;
+    if (atomic_fetch_sub(&share->refs, 1) != 1) return;
+
+    curl_share_cleanup(share->sh);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_destroy(&share->locks[i]);
+    }
+    pxshot_mem_free(share->alloc, share);
+}
+
+pxshot_cancel_t *pxshot_cancel_new(void) {
+    pxshot_cancel_t *cancel = (pxshot_cancel_t *)pxshot_mem_alloc(pxshot_global_allocator, sizeof(pxshot_cancel_t));
+    if (!cancel) return NULL;
+    cancel->alloc = pxshot_global_allocator;
+    atomic_init(&cancel->triggered, false);
+    return cancel;
+}
+
+void pxshot_cancel_trigger(pxshot_cancel_t *cancel) {
+    if (cancel) atomic_store(&cancel->triggered, true);
+}
+
+bool pxshot_cancel_is_triggered(const pxshot_cancel_t *cancel) {
+    return cancel && atomic_load(&cancel->triggered);
+}
+
+void pxshot_cancel_free(pxshot_cancel_t *cancel) {
+    if (cancel) pxshot_mem_free(cancel->alloc, cancel);
+}
+
+uint64_t pxshot_now_ms(void) {
+    return (uint64_t)pxshot_clock_ms();
+}
+
+/* CURL handle pool */
+
+static pxshot_conn_t *pxshot_conn_new(pxshot_pool_t *pool, bool pooled) {
+    pxshot_conn_t *conn = (pxshot_conn_t *)pxshot_mem_calloc(pool->alloc, 1, sizeof(pxshot_conn_t));
+    if (!conn) return NULL;
+    conn->curl = curl_easy_init();
+    if (!conn->curl) {
+        pxshot_mem_free(pool->alloc, conn);
+        return NULL;
+    }
+    conn->pooled = pooled;
+    if (pool->setup) pool->setup(conn->curl, pool->setup_ctx);
+    return conn;
+}
+
+static void pxshot_conn_free(pxshot_pool_t *pool, pxshot_conn_t *conn) {
+    if (!conn) return;
+    if (conn->multi) curl_multi_cleanup(conn->multi);
+    curl_easy_cleanup(conn->curl);
+    pxshot_mem_free(pool->alloc, conn);
+}
+
+static void pxshot_pool_destroy(pxshot_pool_t *pool);
+
+static bool pxshot_pool_init(pxshot_pool_t *pool, const pxshot_allocator_t *alloc, size_t size, size_t max,
+                             void (*setup)(CURL *curl, void *ctx), void *setup_ctx) {
+    pool->alloc = alloc;
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) return false;
+    if (pthread_cond_init(&pool->available, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        return false;
+    }
+    pool->max = max;
+    pool->setup = setup;
+    pool->setup_ctx = setup_ctx;
+    for (size_t i = 0; i < size; i++) {
+        pxshot_conn_t *conn = pxshot_conn_new(pool, true);
+        if (!conn) {
+            pxshot_pool_destroy(pool);
+            return false;
+        }
+        conn->next = pool->idle;
+        pool->idle = conn;
+        pool->idle_count++;
+        pool->total++;
+    }
+    return true;
+}
+
+/* Free the pool; all handles must have been checked back in */
+static void pxshot_pool_destroy(pxshot_pool_t *pool) {
+    while (pool->idle) {
+        pxshot_conn_t *conn = pool->idle;
+        pool->idle = conn->next;
+        pxshot_conn_free(pool, conn);
+    }
+    pthread_cond_destroy(&pool->available);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+/* Pop an idle handle or grow the pool; called with the lock held */
+static pxshot_conn_t *pxshot_pool_take_locked(pxshot_pool_t *pool, bool *grow) {
+    pxshot_conn_t *conn = pool->idle;
+    *grow = false;
+    if (conn) {
+        pool->idle = conn->next;
+        pool->idle_count--;
+        conn->next = NULL;
+    } else if (pool->total < pool->max) {
+        pool->total++;
+        *grow = true;
+    }
+    return conn;
+}
+
+/* Create the handle reserved by pxshot_pool_take_locked() */
+static pxshot_conn_t *pxshot_pool_grow(pxshot_pool_t *pool) {
+    pxshot_conn_t *conn = pxshot_conn_new(pool, true);
+    if (!conn) {
+        pthread_mutex_lock(&pool->lock);
+        pool->total--;
+        pthread_cond_signal(&pool->available);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return conn;
+}
+
+/* Check a handle out, waiting for one to be checked in if the pool is at its cap */
+static pxshot_conn_t *pxshot_pool_acquire(pxshot_pool_t *pool) {
+    bool grow = false;
+    pthread_mutex_lock(&pool->lock);
+    pool->checkouts++;
+    pxshot_conn_t *conn = pxshot_pool_take_locked(pool, &grow);
+    if (!conn && !grow) {
+        uint64_t start = pxshot_clock_ns();
+        while (!conn && !grow) {
+            pthread_cond_wait(&pool->available, &pool->lock);
+            conn = pxshot_pool_take_locked(pool, &grow);
+        }
+        uint64_t waited = pxshot_clock_ns() - start;
+        pool->waits++;
+        pool->wait_ns_total += waited;
+        if (waited > pool->wait_ns_max) pool->wait_ns_max = waited;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return grow ? pxshot_pool_grow(pool) : conn;
+}
+
+/*
+ * Check a handle out without blocking. When the pool is exhausted a
+ * detached handle is created instead; it joins the pool on release if
+ * there is room.
+ */
+static pxshot_conn_t *pxshot_pool_try_acquire(pxshot_pool_t *pool) {
+    bool grow = false;
+    pthread_mutex_lock(&pool->lock);
+    pool->checkouts++;
+    pxshot_conn_t *conn = pxshot_pool_take_locked(pool, &grow);
+    pthread_mutex_unlock(&pool->lock);
+    if (conn) return conn;
+    return grow ? pxshot_pool_grow(pool) : pxshot_conn_new(pool, false);
+}
+
+static void pxshot_pool_release(pxshot_pool_t *pool, pxshot_conn_t *conn) {
+    if (!conn) return;
+    pthread_mutex_lock(&pool->lock);
+    if (!conn->pooled && pool->total < pool->max) {
+        conn->pooled = true;
+        pool->total++;
+    }
+    if (conn->pooled) {
+        conn->next = pool->idle;
+        pool->idle = conn;
+        pool->idle_count++;
+        pthread_cond_signal(&pool->available);
+        conn = NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    pxshot_conn_free(pool, conn);
+}
+
+/* Raise the growth cap so at least n handles can be checked out at once */
+static void pxshot_pool_reserve(pxshot_pool_t *pool, size_t n) {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->max < n) {
+        pool->max = n;
+        pthread_cond_broadcast(&pool->available);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* Build "<base_url><path>" (caller frees) */
+static char *pxshot_endpoint_url(const pxshot_client_t *client, const char *path) {
+    size_t url_len = strlen(client->base_url) + strlen(path) + 1;
+    char *url = (char *)pxshot_mem_alloc(client->alloc, url_len);
+    if (url) snprintf(url, url_len, "%s%s", client->base_url, path);
+    return url;
+}
+
+/* Build the request header list (caller frees with curl_slist_free_all) */
+static struct curl_slist *pxshot_request_headers(const pxshot_client_t *client, bool json) {
+    size_t auth_len = strlen(client->api_key) + 32;
+    char *auth_header = (char *)pxshot_mem_alloc(client->alloc, auth_len);
+    if (!auth_header) return NULL;
+    snprintf(auth_header, auth_len, "Authorization: Bearer %s", client->api_key);
+
+    struct curl_slist *headers = curl_slist_append(NULL, auth_header);
+    pxshot_mem_free(client->alloc, auth_header);
+    if (headers && json) {
+        struct curl_slist *tmp = curl_slist_append(headers, "Content-Type: application/json");
+        if (!tmp) {
+            curl_slist_free_all(headers);
+            return NULL;
+        }
+        headers = tmp;
+    }
+    return headers;
+}
+
+/* Growable output that starts in caller-provided storage */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    char *storage;                  /* Initial buffer, replaced by the heap once outgrown */
+    const pxshot_allocator_t *alloc;
+    bool failed;
+} pxshot_writer_t;
+
+static bool pxshot_writer_reserve(pxshot_writer_t *w, size_t n) {
+    if (w->failed) return false;
+    if (w->len + n <= w->cap) return true;
+    size_t cap = w->cap * 2;
+    while (cap < w->len + n) cap *= 2;
+    char *data = w->data == w->storage ? (char *)pxshot_mem_alloc(w->alloc, cap)
+                                       : (char *)pxshot_mem_realloc(w->alloc, w->data, cap);
+    if (!data) {
+        w->failed = true;
+        return false;
+    }
+    if (w->data == w->storage) memcpy(data, w->storage, w->len);
+    w->data = data;
+    w->cap = cap;
+    return true;
+}
+
+static void pxshot_writer_put(pxshot_writer_t *w, const char *s, size_t n) {
+    if (!pxshot_writer_reserve(w, n)) return;
+    memcpy(w->data + w->len, s, n);
+    w->len += n;
+}
+
+#define PXSHOT_WRITE_LIT(w, lit) pxshot_writer_put((w), (lit), sizeof(lit) - 1)
+
+/* Quoted JSON string; quotes, backslashes and control characters are escaped */
+static void pxshot_writer_string(pxshot_writer_t *w, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    PXSHOT_WRITE_LIT(w, "\"");
+    const unsigned char *p = (const unsigned char *)s;
+    for (;;) {
+        /* Copy the run of characters that need no escaping in one go */
+        const unsigned char *run = p;
+        while (*p >= 0x20 && *p != '"' && *p != '\\') p++;
+        pxshot_writer_put(w, (const char *)run, (size_t)(p - run));
+        if (!*p) break;
+
+        char esc[6] = { '\\', 0 };
+        size_t n = 2;
+        switch (*p) {
+            case '"': esc[1] = '"'; break;
+            case '\\': esc[1] = '\\'; break;
+            case '\b': esc[1] = 'b'; break;
+            case '\f': esc[1] = 'f'; break;
+            case '\n': esc[1] = 'n'; break;
+            case '\r': esc[1] = 'r'; break;
+            case '\t': esc[1] = 't'; break;
+            default:
+                memcpy(esc + 1, "u00", 3);
+                esc[4] = hex[*p >> 4];
+                esc[5] = hex[*p & 0xf];
+                n = 6;
+        }
+        pxshot_writer_put(w, esc, n);
+        p++;
+    }
+    PXSHOT_WRITE_LIT(w, "\"");
+}
+
+static void pxshot_writer_int(pxshot_writer_t *w, int v) {
+    char digits[12];
+    char *end = digits + sizeof(digits), *p = end;
+    unsigned int u = v < 0 ? 0u - (unsigned int)v : (unsigned int)v;
+    do {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0) *--p = '-';
+    pxshot_writer_put(w, p, (size_t)(end - p));
+}
+
+/* Shortest of %.15g and %.17g that reads back exactly */
+static void pxshot_writer_double(pxshot_writer_t *w, double v) {
+    if (!isfinite(v)) {
+        PXSHOT_WRITE_LIT(w, "null");
+        return;
+    }
+    char num[32];
+    int n = snprintf(num, sizeof(num), "%.15g", v);
+    if (strtod(num, NULL) != v) n = snprintf(num, sizeof(num), "%.17g", v);
+
+    /* Both calls follow LC_NUMERIC; JSON always wants '.' */
+    const char *point = localeconv()->decimal_point;
+    size_t point_len = strlen(point);
+    char *at;
+    if (point_len && strcmp(point, ".") != 0 && (at = strstr(num, point)) != NULL) {
+        *at = '.';
+        memmove(at + 1, at + point_len, (size_t)n - (size_t)(at - num) - point_len + 1);
+        n -= (int)point_len - 1;
+    }
+    pxshot_writer_put(w, num, (size_t)n);
+}
+
+/*
+ * Serialize screenshot options into a JSON request body. Uses storage when
+ * the body fits, else memory from alloc; the caller frees a result that is
+ * not storage. NULL on allocation failure.
+ */
+static char *pxshot_build_body(const pxshot_allocator_t *alloc, const pxshot_screenshot_opts_t *opts,
+                               char *storage, size_t storage_len) {
+    pxshot_writer_t w = { .data = storage, .cap = storage_len, .storage = storage, .alloc = alloc };
+
+    PXSHOT_WRITE_LIT(&w, "{\"url\":");
+    pxshot_writer_string(&w, opts->url);
+    PXSHOT_WRITE_LIT(&w, ",\"format\":\"");
+    const char *format = pxshot_format_string(opts->format);
+    pxshot_writer_put(&w, format, strlen(format));
+    PXSHOT_WRITE_LIT(&w, "\"");
+
+    if (opts->quality > 0) {
+        PXSHOT_WRITE_LIT(&w, ",\"quality\":");
+        pxshot_writer_int(&w, opts->quality);
+    }
+    if (opts->width > 0) {
+        PXSHOT_WRITE_LIT(&w, ",\"width\":");
+        pxshot_writer_int(&w, opts->width);
+    }
+    if (opts->height > 0) {
+        PXSHOT_WRITE_LIT(&w, ",\"height\":");
+        pxshot_writer_int(&w, opts->height);
+    }
+    if (opts->full_page)
+        PXSHOT_WRITE_LIT(&w, ",\"full_page\":true");
+    if (opts->wait_until != PXSHOT_WAIT_LOAD) {
+        PXSHOT_WRITE_LIT(&w, ",\"wait_until\":\"");
+        const char *wait_until = pxshot_wait_until_string(opts->wait_until);
+        pxshot_writer_put(&w, wait_until, strlen(wait_until));
+        PXSHOT_WRITE_LIT(&w, "\"");
+    }
+    if (opts->wait_for_selector) {
+        PXSHOT_WRITE_LIT(&w, ",\"wait_for_selector\":");
+        pxshot_writer_string(&w, opts->wait_for_selector);
+    }
+    if (opts->wait_for_timeout > 0) {
+        PXSHOT_WRITE_LIT(&w, ",\"wait_for_timeout\":");
+        pxshot_writer_int(&w, opts->wait_for_timeout);
+    }
+    if (opts->device_scale_factor > 0) {
+        PXSHOT_WRITE_LIT(&w, ",\"device_scale_factor\":");
+        pxshot_writer_double(&w, opts->device_scale_factor);
+    }
+    if (opts->store)
+        PXSHOT_WRITE_LIT(&w, ",\"store\":true");
+    pxshot_writer_put(&w, "}", 2);   /* With the terminating NUL */
+
+    if (w.failed) {
+        if (w.data != storage) pxshot_mem_free(alloc, w.data);
+        return NULL;
+    }
+    return w.data;
+}
+
+/*
+ * Pull reader for the API's JSON responses. It walks the buffer in place:
+ * keys and values are visited in document order, strings come back as
+ * spans of the still-escaped text, and nothing is allocated until the
+ * caller decodes the strings it keeps.
+ */
+typedef struct {
+    const char *p;
+    const char *end;
+    size_t members;                 /* Keys read from the current object */
+    bool done;                      /* Closing brace consumed */
+    bool failed;                    /* Malformed input */
+} pxshot_reader_t;
+
+/* String value as it appears between its quotes */
+typedef struct {
+    const char *s;                  /* NULL until a string was read */
+    size_t len;
+    bool escaped;                   /* Contains backslash escapes */
+} pxshot_reader_str_t;
+
+#define PXSHOT_READER_DEPTH 64
+#define PXSHOT_KEY_IS(key, lit) \
+    ((key)->len == sizeof(lit) - 1 && !(key)->escaped && memcmp((key)->s, (lit), sizeof(lit) - 1) == 0)
+
+/* Word-at-a-time tests over eight bytes: nonzero if some byte is below n (n <= 128), or equals c */
+#define PXSHOT_SWAR_ONES ((uint64_t)0x0101010101010101u)
+#define PXSHOT_SWAR_BELOW(x, n) (((x) - PXSHOT_SWAR_ONES * (n)) & ~(x) & (PXSHOT_SWAR_ONES * 0x80))
+#define PXSHOT_SWAR_HAS(x, c) PXSHOT_SWAR_BELOW((x) ^ (PXSHOT_SWAR_ONES * (c)), 1)
+
+static void pxshot_reader_ws(pxshot_reader_t *r) {
+    const char *p = r->p;
+    /* Indentation comes in runs of spaces */
+    while (r->end - p >= 8 && memcmp(p, "        ", 8) == 0) p += 8;
+    while (p < r->end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+    r->p = p;
+}
+
+static bool pxshot_reader_expect(pxshot_reader_t *r, char c) {
+    pxshot_reader_ws(r);
+    if (r->p < r->end && *r->p == c) {
+        r->p++;
+        return true;
+    }
+    r->failed = true;
+    return false;
+}
+
+static int pxshot_reader_hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Read the string at the cursor, checking its escapes */
+static bool pxshot_reader_string(pxshot_reader_t *r, pxshot_reader_str_t *str) {
+    if (!pxshot_reader_expect(r, '"')) return false;
+    const char *start = r->p, *p = r->p;
+    bool escaped = false;
+    for (;;) {
+        /* Skip eight plain bytes at a time, then find the stop byte */
+        while (r->end - p >= 8) {
+            uint64_t x;
+            memcpy(&x, p, 8);
+            if (PXSHOT_SWAR_BELOW(x, 0x20) | PXSHOT_SWAR_HAS(x, '"') | PXSHOT_SWAR_HAS(x, '\\')) break;
+            p += 8;
+        }
+        while (p < r->end && (unsigned char)*p >= 0x20 && *p != '"' && *p != '\\') p++;
+        if (p >= r->end || (unsigned char)*p < 0x20) break;
+        if (*p == '"') {
+            str->s = start;
+            str->len = (size_t)(p - start);
+            str->escaped = escaped;
+            r->p = p + 1;
+            return true;
+        }
+
+        escaped = true;
+        if (r->end - p < 2) break;
+        if (p[1] == 'u') {
+            if (r->end - p < 6 || pxshot_reader_hex(p[2]) < 0 || pxshot_reader_hex(p[3]) < 0 ||
+                pxshot_reader_hex(p[4]) < 0 || pxshot_reader_hex(p[5]) < 0) break;
+            p += 6;
+        } else if (p[1] && strchr("\"\\/bfnrt", p[1])) {
+            p += 2;
+        } else {
+            break;
+        }
+    }
+    r->failed = true;
+    return false;
+}
+
+static unsigned pxshot_reader_u16(const char *p) {
+    return (unsigned)(pxshot_reader_hex(p[0]) << 12 | pxshot_reader_hex(p[1]) << 8 |
+                      pxshot_reader_hex(p[2]) << 4 | pxshot_reader_hex(p[3]));
+}
+
+/* Unescape str into dst, which has room for str->len + 1 bytes; returns the decoded length */
+static size_t pxshot_reader_decode(char *dst, const pxshot_reader_str_t *str) {
+    if (!str->escaped) {
+        memcpy(dst, str->s, str->len);
+        dst[str->len] = 0;
+        return str->len;
+    }
+    const char *p = str->s, *end = str->s + str->len;
+    char *out = dst;
+    while (p < end) {
+        const char *run = p;
+        while (p < end && *p != '\\') p++;
+        memcpy(out, run, (size_t)(p - run));
+        out += p - run;
+        if (p >= end) break;
+
+        char c = p[1];
+        p += 2;
+        switch (c) {
+            case 'b': *out++ = '\b'; continue;
+            case 'f': *out++ = '\f'; continue;
+            case 'n': *out++ = '\n'; continue;
+            case 'r': *out++ = '\r'; continue;
+            case 't': *out++ = '\t'; continue;
+            case 'u': break;
+            default: *out++ = c; continue;
+        }
+
+        /* \uXXXX to UTF-8; a surrogate pair makes one code point, a lone half U+FFFD */
+        unsigned cp = pxshot_reader_u16(p);
+        p += 4;
+        if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+            unsigned lo = pxshot_reader_u16(p + 2);
+            if (lo >= 0xDC00 && lo < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                p += 6;
+            }
+        }
+        if (cp >= 0xD800 && cp < 0xE000) cp = 0xFFFD;
+        if (cp < 0x80) {
+            *out++ = (char)cp;
+        } else if (cp < 0x800) {
+            *out++ = (char)(0xC0 | cp >> 6);
+            *out++ = (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            *out++ = (char)(0xE0 | cp >> 12);
+            *out++ = (char)(0x80 | (cp >> 6 & 0x3F));
+            *out++ = (char)(0x80 | (cp & 0x3F));
+        } else {
+            *out++ = (char)(0xF0 | cp >> 18);
+            *out++ = (char)(0x80 | (cp >> 12 & 0x3F));
+            *out++ = (char)(0x80 | (cp >> 6 & 0x3F));
+            *out++ = (char)(0x80 | (cp & 0x3F));
+        }
+    }
+    *out = 0;
+    return (size_t)(out - dst);
+}
+
+/* Read the number at the cursor, without going through the locale */
+static bool pxshot_reader_number(pxshot_reader_t *r, double *value) {
+    pxshot_reader_ws(r);
+    const char *p = r->p, *end = r->end;
+    bool neg = p < end && *p == '-';
+    if (neg) p++;
+    if (p >= end || *p < '0' || *p > '9' || (*p == '0' && end - p > 1 && p[1] >= '0' && p[1] <= '9')) {
+        r->failed = true;
+        return false;
+    }
+
+    /* Keep 19 significant digits; the rest only scale */
+    uint64_t mantissa = 0;
+    int digits = 0, exp = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            if (mantissa) digits++;
+        } else {
+            exp++;
+        }
+    }
+    if (p < end && *p == '.') {
+        if (++p >= end || *p < '0' || *p > '9') {
+            r->failed = true;
+            return false;
+        }
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                if (mantissa) digits++;
+                exp--;
+            }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool eneg = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) p++;
+        if (p >= end || *p < '0' || *p > '9') {
+            r->failed = true;
+            return false;
+        }
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (e < 100000) e = e * 10 + (*p - '0');
+        }
+        exp += eneg ? -e : e;
+    }
+
+    double v = (double)mantissa;
+    if (v != 0) {
+        for (; exp > 0 && isfinite(v); exp--) v *= 10;
+        for (; exp < 0 && v != 0; exp++) v /= 10;
+    }
+    *value = neg ? -v : v;
+    r->p = p;
+    return true;
+}
+
+static bool pxshot_reader_literal(pxshot_reader_t *r, const char *lit, size_t len) {
+    if ((size_t)(r->end - r->p) >= len && memcmp(r->p, lit, len) == 0) {
+        r->p += len;
+        return true;
+    }
+    r->failed = true;
+    return false;
+}
+
+/* Step over the value at the cursor, whatever it is */
+static bool pxshot_reader_skip_depth(pxshot_reader_t *r, int depth) {
+    pxshot_reader_ws(r);
+    if (r->p >= r->end || depth > PXSHOT_READER_DEPTH) {
+        r->failed = true;
+        return false;
+    }
+    pxshot_reader_str_t str;
+    double num;
+    switch (*r->p) {
+        case '"': return pxshot_reader_string(r, &str);
+        case 't': return pxshot_reader_literal(r, "true", 4);
+        case 'f': return pxshot_reader_literal(r, "false", 5);
+        case 'n': return pxshot_reader_literal(r, "null", 4);
+        case '{':
+        case '[': {
+            char close = *r->p == '{' ? '}' : ']';
+            r->p++;
+            pxshot_reader_ws(r);
+            if (r->p < r->end && *r->p == close) {
+                r->p++;
+                return true;
+            }
+            for (;;) {
+                if (close == '}' && (!pxshot_reader_string(r, &str) || !pxshot_reader_expect(r, ':'))) return false;
+                if (!pxshot_reader_skip_depth(r, depth + 1)) return false;
+                pxshot_reader_ws(r);
+                if (r->p >= r->end || *r->p != ',') break;
+                r->p++;
+            }
+            return pxshot_reader_expect(r, close);
+        }
+        default: return pxshot_reader_number(r, &num);
+    }
+}
+
+static bool pxshot_reader_skip(pxshot_reader_t *r) {
+    return pxshot_reader_skip_depth(r, 0);
+}
+
+/* Start reading the object that makes up data */
+static void pxshot_reader_object(pxshot_reader_t *r, const void *data, size_t len) {
+    memset(r, 0, sizeof(*r));
+    if (!data) {
+        r->failed = true;
+        return;
+    }
+    r->p = (const char *)data;
+    r->end = r->p + len;
+    pxshot_reader_expect(r, '{');
+}
+
+/* Read the next key and its colon; false once the object ends or the input is malformed */
+static bool pxshot_reader_key(pxshot_reader_t *r, pxshot_reader_str_t *key) {
+    if (r->failed || r->done) return false;
+    pxshot_reader_ws(r);
+    if (r->p < r->end && *r->p == '}') {
+        r->p++;
+        r->done = true;
+        return false;
+    }
+    if (r->members++ > 0 && !pxshot_reader_expect(r, ',')) return false;
+    return pxshot_reader_string(r, key) && pxshot_reader_expect(r, ':');
+}
+
+/* Read a string value; any other value is skipped and leaves str untouched */
+static bool pxshot_reader_get_string(pxshot_reader_t *r, pxshot_reader_str_t *str) {
+    pxshot_reader_ws(r);
+    if (r->p < r->end && *r->p == '"') return pxshot_reader_string(r, str);
+    pxshot_reader_skip(r);
+    return false;
+}
+
+/* Read a number value; any other value is skipped and leaves value untouched */
+static bool pxshot_reader_get_number(pxshot_reader_t *r, double *value) {
+    pxshot_reader_ws(r);
+    if (r->p < r->end && (*r->p == '-' || (*r->p >= '0' && *r->p <= '9'))) return pxshot_reader_number(r, value);
+    pxshot_reader_skip(r);
+    return false;
+}
+
+static int pxshot_reader_int(double v) {
+    return v >= INT_MAX ? INT_MAX : v <= INT_MIN ? INT_MIN : (int)v;
+}
+
+/* Decode a string into the response (NULL if none was read) */
+static char *pxshot_response_json_string(pxshot_response_t *resp, const pxshot_reader_str_t *str) {
+    if (!str->s) return NULL;
+    char *dup = pxshot_response_reserve(resp, str->len);
+    if (dup) pxshot_reader_decode(dup, str);
+    return dup;
+}
+
+/*
+ * Canonical form of the options that determine the captured image, with
+ * defaults filled in so that e.g. width 0 and width 1280 compare equal.
+ * Fields are separated by US (0x1f).
+ */
+static char *pxshot_opts_key(const pxshot_allocator_t *alloc, const pxshot_screenshot_opts_t *opts,
+                             uint64_t *hash) {
+    int quality = opts->format == PXSHOT_FORMAT_PNG ? 0 : (opts->quality > 0 ? opts->quality : 80);
+    int width = opts->width > 0 ? opts->width : 1280;
+    int height = opts->height > 0 ? opts->height : 720;
+    double scale = opts->device_scale_factor > 0 ? opts->device_scale_factor : 1.0;
+    int wait_timeout = opts->wait_for_timeout > 0 ? opts->wait_for_timeout : 0;
+    const char *selector = opts->wait_for_selector;
+
+    const char *fmt = "%s\x1f%d\x1f%d\x1f%d\x1f%d\x1f%d\x1f%d\x1f%c%s\x1f%d\x1f%.17g\x1f%d\x1f%d";
+    int len = snprintf(NULL, 0, fmt, opts->url, (int)opts->format, quality, width, height,
+                       (int)opts->full_page, (int)opts->wait_until, selector ? '+' : '-',
+                       selector ? selector : "", wait_timeout, scale, (int)opts->store, (int)opts->block_ads);
+    char *key = len >= 0 ? (char *)pxshot_mem_alloc(alloc, (size_t)len + 1) : NULL;
+    if (!key) return NULL;
+    snprintf(key, (size_t)len + 1, fmt, opts->url, (int)opts->format, quality, width, height,
+             (int)opts->full_page, (int)opts->wait_until, selector ? '+' : '-',
+             selector ? selector : "", wait_timeout, scale, (int)opts->store, (int)opts->block_ads);
+
+    /* FNV-1a */
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char *p = key; *p; p++) h = (h ^ (uint8_t)*p) * 0x100000001b3ULL;
+    *hash = h;
+    return key;
+}
+
+/* Apply the client-wide transfer options to a new CURL handle (pool setup hook) */
+static void pxshot_conn_setup(CURL *curl, void *ctx) {
+    const pxshot_client_t *client = (const pxshot_client_t *)ctx;
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, client->timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, pxshot_write_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, pxshot_header_callback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, pxshot_xferinfo_callback);
+    if (client->share) curl_easy_setopt(curl, CURLOPT_SHARE, client->share->sh);
+    if (client->ca_file) curl_easy_setopt(curl, CURLOPT_CAINFO, client->ca_file);
+    if (client->http2) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+        /* Wait for an existing connection to offer a stream rather than open another */
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+}
+
+/*
+ * Account a finished transfer in the client's transport statistics.
+ * multiplexed: another transfer ran on the same connection meanwhile.
+ */
+static void pxshot_transport_record(pxshot_client_t *client, CURL *curl, bool multiplexed) {
+    long connects = 0;
+    long version = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+
+    atomic_fetch_add_explicit(&client->stat_requests, 1, memory_order_relaxed);
+    if (connects > 0) {
+        atomic_fetch_add_explicit(&client->stat_connections, 1, memory_order_relaxed);
+    }
+    if (version == CURL_HTTP_VERSION_2_0) {
+        atomic_fetch_add_explicit(&client->stat_http2_streams, 1, memory_order_relaxed);
+        if (multiplexed) {
+            atomic_fetch_add_explicit(&client->stat_http2_multiplexed, 1, memory_order_relaxed);
+        }
+    }
+}
+
+/* Point a handle at an endpoint; URL and headers are only set when it changes */
+static void pxshot_conn_prepare(const pxshot_client_t *client, pxshot_conn_t *conn,
+                                pxshot_endpoint_t endpoint, pxshot_buffer_t *buffer) {
+    CURL *curl = conn->curl;
+    if (conn->endpoint != endpoint) {
+        if (endpoint == PXSHOT_ENDPOINT_SCREENSHOT) {
+            curl_easy_setopt(curl, CURLOPT_URL, client->screenshot_url);
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, client->json_headers);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_URL, client->usage_url);
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, client->auth_headers);
+            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        }
+        conn->endpoint = endpoint;
+    }
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, buffer);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, buffer);
+    buffer->alloc = client->alloc;
+    buffer->pool = client->bufpool;
+}
+
+/* Configure a handle for a screenshot POST */
+static void pxshot_setup_screenshot(const pxshot_client_t *client, pxshot_conn_t *conn,
+                                    const char *body, pxshot_buffer_t *buffer) {
+    pxshot_conn_prepare(client, conn, PXSHOT_ENDPOINT_SCREENSHOT, buffer);
+    curl_easy_setopt(conn->curl, CURLOPT_POSTFIELDSIZE, (long)strlen(body));
+    curl_easy_setopt(conn->curl, CURLOPT_POSTFIELDS, body);
+}
+
+/*
+ * Attach a request's guard to a handle (NULL = none). The progress callback
+ * only runs for guarded requests, and a deadline tightens the transfer
+ * timeout so a stalled connection cannot outlive it.
+ */
+static void pxshot_conn_guard(const pxshot_client_t *client, pxshot_conn_t *conn,
+                              pxshot_guard_t *guard) {
+    CURL *curl = conn->curl;
+    if (pxshot_guard_active(guard)) {
+        long timeout_ms = client->timeout_ms;
+        guard->deadline_bound = false;
+        if (guard->deadline_ms) {
+            uint64_t now = (uint64_t)pxshot_clock_ms();
+            uint64_t left = guard->deadline_ms > now ? guard->deadline_ms - now : 1;
+            if (left < (uint64_t)timeout_ms) {
+                timeout_ms = (long)left;
+                guard->deadline_bound = true;
+            }
+        }
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, guard);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        conn->guarded = true;
+    } else if (conn->guarded) {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, client->timeout_ms);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+        conn->guarded = false;
+    }
+}
+
+/* Circuit breaker */
+
+static void pxshot_breaker_open_locked(pxshot_breaker_t *b, uint64_t now) {
+    b->state = PXSHOT_CIRCUIT_OPEN;
+    b->opened_ms = now;
+    b->opened++;
+}
+
+/* Move an open circuit to half-open once its open period is over */
+static void pxshot_breaker_refresh_locked(const pxshot_client_t *client, pxshot_breaker_t *b, uint64_t now) {
+    if (b->state == PXSHOT_CIRCUIT_OPEN && now - b->opened_ms >= (uint64_t)client->circuit.open_ms) {
+        b->state = PXSHOT_CIRCUIT_HALF_OPEN;
+        b->probes_inflight = 0;
+        b->probe_successes = 0;
+    }
+}
+
+static void pxshot_breaker_window_locked(const pxshot_client_t *client, const pxshot_breaker_t *b,
+                                         uint64_t now, uint32_t *requests, uint32_t *failures) {
+    *requests = *failures = 0;
+    for (int i = 0; i < PXSHOT_BREAKER_BUCKETS; i++) {
+        if (b->buckets[i].start_ms + (uint64_t)client->circuit.window_ms > now) {
+            *requests += b->buckets[i].requests;
+            *failures += b->buckets[i].failures;
+        }
+    }
+}
+
+/* PXSHOT_OK to send the request, PXSHOT_ERR_CIRCUIT_OPEN to fail fast */
+static pxshot_error_t pxshot_breaker_admit(pxshot_client_t *client, pxshot_api_t api, bool *probe) {
+    *probe = false;
+    if (client->circuit.failure_ratio <= 0) return PXSHOT_OK;
+
+    pxshot_breaker_t *b = &client->breakers[api];
+    pxshot_error_t result = PXSHOT_OK;
+    pthread_mutex_lock(&b->lock);
+    pxshot_breaker_refresh_locked(client, b, (uint64_t)pxshot_clock_ms());
+    if (b->state == PXSHOT_CIRCUIT_OPEN) {
+        result = PXSHOT_ERR_CIRCUIT_OPEN;
+    } else if (b->state == PXSHOT_CIRCUIT_HALF_OPEN) {
+        if (b->probes_inflight + b->probe_successes < client->circuit.half_open_probes) {
+            b->probes_inflight++;
+            *probe = true;
+        } else {
+            result = PXSHOT_ERR_CIRCUIT_OPEN;
+        }
+    }
+    if (result != PXSHOT_OK) b->rejected++;
+    pthread_mutex_unlock(&b->lock);
+    return result;
+}
+
+static void pxshot_breaker_record(pxshot_client_t *client, pxshot_api_t api, bool probe,
+                                  pxshot_outcome_t outcome) {
+    if (client->circuit.failure_ratio <= 0) return;
+
+    pxshot_breaker_t *b = &client->breakers[api];
+    uint64_t now = (uint64_t)pxshot_clock_ms();
+    pthread_mutex_lock(&b->lock);
+    if (probe) {
+        /* Only probes decide a half-open circuit; late results of earlier requests do not */
+        if (b->state == PXSHOT_CIRCUIT_HALF_OPEN) {
+            b->probes_inflight--;
+            if (outcome == PXSHOT_OUTCOME_FAILURE) {
+                pxshot_breaker_open_locked(b, now);
+            } else if (outcome == PXSHOT_OUTCOME_SUCCESS &&
+                       ++b->probe_successes >= client->circuit.half_open_probes) {
+                b->state = PXSHOT_CIRCUIT_CLOSED;
+                memset(b->buckets, 0, sizeof(b->buckets));
+            }
+        }
+    } else if (b->state == PXSHOT_CIRCUIT_CLOSED && outcome != PXSHOT_OUTCOME_NEUTRAL) {
+        uint64_t span = (uint64_t)client->circuit.window_ms / PXSHOT_BREAKER_BUCKETS;
+        uint64_t start = now - now % span;
+        int i = (int)((now / span) % PXSHOT_BREAKER_BUCKETS);
+        if (b->buckets[i].start_ms != start) {
+            b->buckets[i].start_ms = start;
+            b->buckets[i].requests = 0;
+            b->buckets[i].failures = 0;
+        }
+        b->buckets[i].requests++;
+        if (outcome == PXSHOT_OUTCOME_FAILURE) b->buckets[i].failures++;
+
+        uint32_t requests, failures;
+        pxshot_breaker_window_locked(client, b, now, &requests, &failures);
+        if (requests >= (uint32_t)client->circuit.min_requests &&
+            failures >= client->circuit.failure_ratio * requests) {
+            pxshot_breaker_open_locked(b, now);
+        }
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+/* Classify a finished screenshot attempt for the breaker */
+static pxshot_outcome_t pxshot_breaker_outcome(const pxshot_client_t *client, const pxshot_response_t *resp,
+                                               uint64_t elapsed_ms) {
+    if (resp->error == PXSHOT_ERR_CANCELLED || resp->error == PXSHOT_ERR_DEADLINE) return PXSHOT_OUTCOME_NEUTRAL;
+    if (resp->retryable) return PXSHOT_OUTCOME_FAILURE;
+    if (client->circuit.slow_call_ms && elapsed_ms >= (uint64_t)client->circuit.slow_call_ms) {
+        return PXSHOT_OUTCOME_FAILURE;
+    }
+    return PXSHOT_OUTCOME_SUCCESS;
+}
+
+/* In-memory cache */
+
+static pxshot_cache_shard_t *pxshot_cache_shard(const pxshot_client_t *client, uint64_t hash) {
+    /* Buckets use the low bits; pick the shard from the high ones */
+    return &client->cache_shards[(hash >> 32) % (uint64_t)client->cache.shards];
+}
+
+static pxshot_cache_entry_t **pxshot_cache_find(pxshot_cache_shard_t *shard, uint64_t hash, const char *key) {
+    pxshot_cache_entry_t **slot = &shard->buckets[hash % PXSHOT_CACHE_BUCKETS];
+    while (*slot && ((*slot)->hash != hash || strcmp((*slot)->key, key) != 0)) slot = &(*slot)->chain;
+    return slot;
+}
+
+static void pxshot_cache_lru_unlink(pxshot_cache_shard_t *shard, pxshot_cache_entry_t *entry) {
+    if (entry->prev) entry->prev->next = entry->next;
+    else shard->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else shard->tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+static void pxshot_cache_lru_push(pxshot_cache_shard_t *shard, pxshot_cache_entry_t *entry) {
+    entry->prev = NULL;
+    entry->next = shard->head;
+    if (shard->head) shard->head->prev = entry;
+    else shard->tail = entry;
+    shard->head = entry;
+}
+
+/* Unlink and free an entry with the shard lock held */
+static void pxshot_cache_remove(pxshot_client_t *client, pxshot_cache_shard_t *shard,
+                                pxshot_cache_entry_t **slot) {
+    pxshot_cache_entry_t *entry = *slot;
+    *slot = entry->chain;
+    pxshot_cache_lru_unlink(shard, entry);
+    shard->bytes -= entry->charge;
+    shard->entries--;
+    pxshot_blob_release(entry->blob);
+    pxshot_mem_free(client->alloc, entry->key);
+    pxshot_mem_free(client->alloc, entry);
+}
+
+/* Fill resp from the cache; returns false on a miss */
+static bool pxshot_cache_get(pxshot_client_t *client, const char *key, uint64_t hash,
+                             pxshot_response_t *resp) {
+    pxshot_cache_shard_t *shard = pxshot_cache_shard(client, hash);
+    bool hit = false;
+    pthread_mutex_lock(&shard->lock);
+    pxshot_cache_entry_t **slot = pxshot_cache_find(shard, hash, key);
+    if (*slot && (*slot)->expires_ms <= (uint64_t)pxshot_clock_ms()) {
+        pxshot_cache_remove(client, shard, slot);
+        atomic_fetch_add_explicit(&client->stat_cache_expirations, 1, memory_order_relaxed);
+    } else if (*slot) {
+        pxshot_cache_entry_t *entry = *slot;
+        pxshot_cache_lru_unlink(shard, entry);
+        pxshot_cache_lru_push(shard, entry);
+        pxshot_response_attach(resp, entry->blob);
+        hit = true;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    if (hit) {
+        resp->error = PXSHOT_OK;
+        resp->http_status = 200;
+        resp->cached = true;
+    }
+    atomic_fetch_add_explicit(hit ? &client->stat_cache_hits : &client->stat_cache_misses, 1,
+                              memory_order_relaxed);
+    return hit;
+}
+
+/* Cache a successful image response, sharing its bytes */
+static void pxshot_cache_put(pxshot_client_t *client, const char *key, uint64_t hash,
+                             pxshot_response_t *resp) {
+    if (resp->error != PXSHOT_OK || !resp->data || resp->stored) return;
+
+    size_t key_len = strlen(key);
+    size_t charge = sizeof(pxshot_cache_entry_t) + key_len + 1 + sizeof(pxshot_blob_t) + resp->data_len;
+    if (charge > client->cache_shard_bytes) return;
+
+    pxshot_blob_t *blob = pxshot_response_share(resp);
+    pxshot_cache_entry_t *entry = blob ?
+        (pxshot_cache_entry_t *)pxshot_mem_calloc(client->alloc, 1, sizeof(pxshot_cache_entry_t)) : NULL;
+    char *key_copy = entry ? (char *)pxshot_mem_alloc(client->alloc, key_len + 1) : NULL;
+    if (!key_copy) {
+        pxshot_mem_free(client->alloc, entry);
+        return;
+    }
+    memcpy(key_copy, key, key_len + 1);
+    entry->hash = hash;
+    entry->key = key_copy;
+    entry->blob = pxshot_blob_retain(blob);
+    entry->charge = charge;
+    entry->expires_ms = (uint64_t)pxshot_clock_ms() + (uint64_t)client->cache.ttl_ms;
+
+    pxshot_cache_shard_t *shard = pxshot_cache_shard(client, hash);
+    pthread_mutex_lock(&shard->lock);
+    pxshot_cache_entry_t **slot = pxshot_cache_find(shard, hash, key);
+    if (*slot) pxshot_cache_remove(client, shard, slot);
+    while (shard->bytes + charge > client->cache_shard_bytes && shard->tail) {
+        pxshot_cache_entry_t *victim = shard->tail;
+        pxshot_cache_remove(client, shard, pxshot_cache_find(shard, victim->hash, victim->key));
+        atomic_fetch_add_explicit(&client->stat_cache_evictions, 1, memory_order_relaxed);
+    }
+    slot = &shard->buckets[hash % PXSHOT_CACHE_BUCKETS];
+    entry->chain = *slot;
+    *slot = entry;
+    pxshot_cache_lru_push(shard, entry);
+    shard->bytes += charge;
+    shard->entries++;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+static void pxshot_cache_destroy(pxshot_client_t *client) {
+    if (!client->cache_shards) return;
+    for (int i = 0; i < client->cache.shards; i++) {
+        pxshot_cache_shard_t *shard = &client->cache_shards[i];
+        while (shard->head) {
+            pxshot_cache_entry_t *entry = shard->head;
+            pxshot_cache_remove(client, shard, pxshot_cache_find(shard, entry->hash, entry->key));
+        }
+        pthread_mutex_destroy(&shard->lock);
+    }
+    pxshot_mem_free(client->alloc, client->cache_shards);
+    client->cache_shards = NULL;
+}
+
+/* Disk cache */
+
+static int64_t pxshot_wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t pxshot_mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* 128-bit hash for naming files: two differently mixed lanes over 8-byte words */
+static void pxshot_hash128(const void *data, size_t len, uint64_t out[2]) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t a = 0x9e3779b97f4a7c15ULL ^ (uint64_t)len;
+    uint64_t b = 0x87c37b91114253d5ULL + (uint64_t)len;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        a = pxshot_mix64(a ^ w);
+        b = (b ^ w) * 0x4cf5ad432745937fULL;
+        b = (b << 31) | (b >> 33);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p, len);
+    out[0] = pxshot_mix64(a ^ tail);
+    out[1] = pxshot_mix64(b ^ tail ^ out[0]);
+}
+
+static void pxshot_disk_path(const pxshot_disk_t *disk, const uint64_t id[2], char *path) {
+    snprintf(path, PXSHOT_DISK_PATH_MAX, "%s/objects/%02x/%016llx%016llx", disk->dir,
+             (unsigned)(id[0] >> 56), (unsigned long long)id[0], (unsigned long long)id[1]);
+}
+
+static pxshot_disk_entry_t **pxshot_disk_find(pxshot_disk_t *disk, const uint64_t key[2]) {
+    pxshot_disk_entry_t **slot = &disk->entries[key[0] % PXSHOT_DISK_BUCKETS];
+    while (*slot && ((*slot)->key[0] != key[0] || (*slot)->key[1] != key[1])) slot = &(*slot)->chain;
+    return slot;
+}
+
+static pxshot_disk_object_t **pxshot_disk_object_find(pxshot_disk_t *disk, const uint64_t id[2]) {
+    pxshot_disk_object_t **slot = &disk->objects[id[0] % PXSHOT_DISK_BUCKETS];
+    while (*slot && ((*slot)->id[0] != id[0] || (*slot)->id[1] != id[1])) slot = &(*slot)->chain;
+    return slot;
+}
+
+static void pxshot_disk_lru_unlink(pxshot_disk_t *disk, pxshot_disk_entry_t *entry) {
+    if (entry->prev) entry->prev->next = entry->next;
+    else disk->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else disk->tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+static void pxshot_disk_lru_push(pxshot_disk_t *disk, pxshot_disk_entry_t *entry) {
+    entry->prev = NULL;
+    entry->next = disk->head;
+    if (disk->head) disk->head->prev = entry;
+    else disk->tail = entry;
+    disk->head = entry;
+}
+
+static void pxshot_disk_record(const pxshot_disk_entry_t *entry, pxshot_disk_record_t *rec) {
+    memcpy(rec->key, entry->key, sizeof(rec->key));
+    memcpy(rec->id, entry->object->id, sizeof(rec->id));
+    rec->size = entry->object->size;
+    rec->created_ms = entry->created_ms;
+    rec->used_ms = entry->used_ms;
+}
+
+/* Rewrite the index as one record per entry, least recently used first */
+static void pxshot_disk_compact(pxshot_disk_t *disk) {
+    char path[PXSHOT_DISK_PATH_MAX], tmp[PXSHOT_DISK_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/index", disk->dir);
+    snprintf(tmp, sizeof(tmp), "%s/index.tmp", disk->dir);
+
+    FILE *out = fopen(tmp, "wb");
+    if (!out) return;
+    bool ok = fwrite(PXSHOT_DISK_MAGIC, 8, 1, out) == 1;
+    size_t records = 0;
+    for (const pxshot_disk_entry_t *entry = disk->tail; ok && entry; entry = entry->prev) {
+        pxshot_disk_record_t rec;
+        pxshot_disk_record(entry, &rec);
+        ok = fwrite(&rec, sizeof(rec), 1, out) == 1;
+        records++;
+    }
+    if (fclose(out) != 0) ok = false;
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return;
+    }
+    if (disk->journal) fclose(disk->journal);
+    disk->journal = fopen(path, "ab");
+    disk->journal_records = records;
+}
+
+/* Append a change to the index; entry NULL records a removal of key */
+static void pxshot_disk_journal(pxshot_disk_t *disk, const pxshot_disk_entry_t *entry, const uint64_t key[2]) {
+    if (!disk->journal) return;
+    pxshot_disk_record_t rec = {0};
+    if (entry) pxshot_disk_record(entry, &rec);
+    else memcpy(rec.key, key, sizeof(rec.key));
+    if (fwrite(&rec, sizeof(rec), 1, disk->journal) != 1 || fflush(disk->journal) != 0) return;
+    if (++disk->journal_records > 2 * disk->entry_count + 1024) pxshot_disk_compact(disk);
+}
+
+/* Unlink and free an entry with the lock held, deleting its image once unreferenced */
+static void pxshot_disk_remove(pxshot_disk_t *disk, pxshot_disk_entry_t **slot, bool journal) {
+    pxshot_disk_entry_t *entry = *slot;
+    *slot = entry->chain;
+    pxshot_disk_lru_unlink(disk, entry);
+    disk->entry_count--;
+    if (journal) pxshot_disk_journal(disk, NULL, entry->key);
+
+    pxshot_disk_object_t *object = entry->object;
+    if (--object->refs == 0) {
+        char path[PXSHOT_DISK_PATH_MAX];
+        pxshot_disk_path(disk, object->id, path);
+        unlink(path);
+        pxshot_disk_object_t **oslot = pxshot_disk_object_find(disk, object->id);
+        *oslot = object->chain;
+        disk->object_count--;
+        disk->bytes -= object->size;
+        pxshot_mem_free(disk->alloc, object);
+    }
+    pxshot_mem_free(disk->alloc, entry);
+}
+
+/* Point key at image id with the lock held, replacing any previous entry */
+static pxshot_disk_entry_t *pxshot_disk_insert(pxshot_disk_t *disk, const uint64_t key[2], const uint64_t id[2],
+                                               uint64_t size, int64_t created_ms, int64_t used_ms) {
+    pxshot_disk_entry_t *entry = (pxshot_disk_entry_t *)pxshot_mem_calloc(disk->alloc, 1, sizeof(pxshot_disk_entry_t));
+    if (!entry) return NULL;
+    pxshot_disk_object_t **oslot = pxshot_disk_object_find(disk, id);
+    if (!*oslot) {
+        pxshot_disk_object_t *object =
+            (pxshot_disk_object_t *)pxshot_mem_calloc(disk->alloc, 1, sizeof(pxshot_disk_object_t));
+        if (!object) {
+            pxshot_mem_free(disk->alloc, entry);
+            return NULL;
+        }
+        memcpy(object->id, id, sizeof(object->id));
+        object->size = size;
+        *oslot = object;
+        disk->object_count++;
+        disk->bytes += size;
+    }
+    entry->object = *oslot;
+    entry->object->refs++;
+
+    pxshot_disk_entry_t **slot = pxshot_disk_find(disk, key);
+    if (*slot) pxshot_disk_remove(disk, slot, false);
+    memcpy(entry->key, key, sizeof(entry->key));
+    entry->created_ms = created_ms;
+    entry->used_ms = used_ms;
+    entry->chain = *slot;
+    *slot = entry;
+    pxshot_disk_lru_push(disk, entry);
+    disk->entry_count++;
+    return entry;
+}
+
+/* Evict least recently used entries until the images fit the quota */
+static void pxshot_disk_evict(pxshot_client_t *client, pxshot_disk_t *disk, bool journal) {
+    while (disk->bytes > client->disk_cache.max_bytes && disk->tail) {
+        pxshot_disk_remove(disk, pxshot_disk_find(disk, disk->tail->key), journal);
+        atomic_fetch_add_explicit(&client->stat_disk_evictions, 1, memory_order_relaxed);
+    }
+}
+
+static int pxshot_disk_compare_used(const void *a, const void *b) {
+    int64_t x = (*(pxshot_disk_entry_t *const *)a)->used_ms;
+    int64_t y = (*(pxshot_disk_entry_t *const *)b)->used_ms;
+    return x < y ? -1 : x > y;
+}
+
+/* Delete files the index does not name: leftovers of crashes and removed entries */
+static void pxshot_disk_sweep(pxshot_disk_t *disk) {
+    char path[PXSHOT_DISK_PATH_MAX];
+    for (unsigned i = 0; i < 256; i++) {
+        int n = snprintf(path, sizeof(path), "%s/objects/%02x", disk->dir, i);
+        if (n < 0 || (size_t)n >= sizeof(path)) return;
+        DIR *d = opendir(path);
+        if (!d) continue;
+        struct dirent *ent;
+        while ((ent = readdir(d)) != NULL) {
+            if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+            unsigned long long hi, lo;
+            uint64_t id[2];
+            bool known = strlen(ent->d_name) == 32 && strspn(ent->d_name, "0123456789abcdef") == 32 &&
+                         sscanf(ent->d_name, "%16llx%16llx", &hi, &lo) == 2;
+            if (known) {
+                id[0] = hi;
+                id[1] = lo;
+                known = *pxshot_disk_object_find(disk, id) != NULL;
+            }
+            if (!known) {
+                /* Never unlink a truncated, and so different, path */
+                char file[PXSHOT_DISK_PATH_MAX];
+                n = snprintf(file, sizeof(file), "%s/%s", path, ent->d_name);
+                if (n >= 0 && (size_t)n < sizeof(file)) unlink(file);
+            }
+        }
+        closedir(d);
+    }
+}
+
+/* Replay the index, drop stale entries and files, then rewrite it compactly */
+static void pxshot_disk_load(pxshot_client_t *client, pxshot_disk_t *disk) {
+    char path[PXSHOT_DISK_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/index", disk->dir);
+    FILE *in = fopen(path, "rb");
+    char magic[8];
+    if (in && fread(magic, 8, 1, in) == 1 && memcmp(magic, PXSHOT_DISK_MAGIC, 8) == 0) {
+        pxshot_disk_record_t rec;
+        while (fread(&rec, sizeof(rec), 1, in) == 1) {
+            if (rec.id[0] || rec.id[1]) {
+                pxshot_disk_insert(disk, rec.key, rec.id, rec.size, rec.created_ms, rec.used_ms);
+            } else {
+                pxshot_disk_entry_t **slot = pxshot_disk_find(disk, rec.key);
+                if (*slot) pxshot_disk_remove(disk, slot, false);
+            }
+        }
+    }
+    if (in) fclose(in);
+
+    for (size_t i = 0; i < PXSHOT_DISK_BUCKETS; i++) {
+        for (pxshot_disk_object_t *object = disk->objects[i]; object; object = object->chain) {
+            struct stat st;
+            pxshot_disk_path(disk, object->id, path);
+            object->missing = stat(path, &st) != 0 || (uint64_t)st.st_size != object->size;
+        }
+    }
+
+    int64_t now = pxshot_wall_ms();
+    pxshot_disk_entry_t **order = disk->entry_count ?
+        (pxshot_disk_entry_t **)pxshot_mem_calloc(disk->alloc, disk->entry_count, sizeof(pxshot_disk_entry_t *)) : NULL;
+    size_t count = 0;
+    for (pxshot_disk_entry_t *entry = disk->head, *next; entry; entry = next) {
+        next = entry->next;
+        bool expired = entry->created_ms + client->disk_cache.ttl_ms <= now;
+        if (expired || entry->object->missing) {
+            pxshot_disk_remove(disk, pxshot_disk_find(disk, entry->key), false);
+            if (expired) atomic_fetch_add_explicit(&client->stat_disk_expirations, 1, memory_order_relaxed);
+        } else if (order) {
+            order[count++] = entry;
+        }
+    }
+
+    /* Replay order is write order; rebuild the LRU list from the use times */
+    if (order) {
+        qsort(order, count, sizeof(*order), pxshot_disk_compare_used);
+        disk->head = disk->tail = NULL;
+        for (size_t i = 0; i < count; i++) pxshot_disk_lru_push(disk, order[i]);
+        pxshot_mem_free(disk->alloc, order);
+    }
+
+    pxshot_disk_evict(client, disk, false);
+    pxshot_disk_sweep(disk);
+    pxshot_disk_compact(disk);
+}
+
+static void pxshot_disk_close(pxshot_disk_t *disk) {
+    if (!disk) return;
+    if (disk->journal) {
+        /* Persist the use times, which are not journaled on hits */
+        pxshot_disk_compact(disk);
+        fclose(disk->journal);
+    }
+    while (disk->head) {
+        pxshot_disk_entry_t *entry = disk->head;
+        disk->head = entry->next;
+        pxshot_mem_free(disk->alloc, entry);
+    }
+    for (size_t i = 0; i < PXSHOT_DISK_BUCKETS; i++) {
+        while (disk->objects[i]) {
+            pxshot_disk_object_t *object = disk->objects[i];
+            disk->objects[i] = object->chain;
+            pxshot_mem_free(disk->alloc, object);
+        }
+    }
+    if (disk->lock_fd >= 0) close(disk->lock_fd);
+    pthread_mutex_destroy(&disk->lock);
+    pxshot_mem_free(disk->alloc, disk->dir);
+    pxshot_mem_free(disk->alloc, disk);
+}
+
+static pxshot_disk_t *pxshot_disk_open(pxshot_client_t *client) {
+    const char *dir = client->disk_cache.dir;
+    char path[PXSHOT_DISK_PATH_MAX];
+    if (strlen(dir) > PXSHOT_DISK_PATH_MAX - 64) return NULL;
+    snprintf(path, sizeof(path), "%s/objects", dir);
+    if ((mkdir(dir, 0755) != 0 && errno != EEXIST) || (mkdir(path, 0755) != 0 && errno != EEXIST)) {
+        return NULL;
+    }
+
+    pxshot_disk_t *disk = (pxshot_disk_t *)pxshot_mem_calloc(client->alloc, 1, sizeof(pxshot_disk_t));
+    if (!disk) return NULL;
+    disk->alloc = client->alloc;
+    pthread_mutex_init(&disk->lock, NULL);
+    disk->dir = pxshot_strdup(disk->alloc, dir);
+    snprintf(path, sizeof(path), "%s/lock", dir);
+    disk->lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (!disk->dir || disk->lock_fd < 0 || flock(disk->lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        pxshot_disk_close(disk);
+        return NULL;
+    }
+    pxshot_disk_load(client, disk);
+    return disk;
+}
+
+/* Map a cached image into resp; returns false on a miss */
+static bool pxshot_disk_get(pxshot_client_t *client, const char *key, pxshot_response_t *resp) {
+    pxshot_disk_t *disk = client->disk;
+    uint64_t k[2], id[2];
+    uint64_t size = 0;
+    pxshot_hash128(key, strlen(key), k);
+    int64_t now = pxshot_wall_ms();
+
+    pthread_mutex_lock(&disk->lock);
+    pxshot_disk_entry_t **slot = pxshot_disk_find(disk, k);
+    if (*slot && (*slot)->created_ms + client->disk_cache.ttl_ms <= now) {
+        pxshot_disk_remove(disk, slot, true);
+        atomic_fetch_add_explicit(&client->stat_disk_expirations, 1, memory_order_relaxed);
+    } else if (*slot) {
+        pxshot_disk_entry_t *entry = *slot;
+        entry->used_ms = now;
+        pxshot_disk_lru_unlink(disk, entry);
+        pxshot_disk_lru_push(disk, entry);
+        memcpy(id, entry->object->id, sizeof(id));
+        size = entry->object->size;
+    }
+    pthread_mutex_unlock(&disk->lock);
+
+    void *map = MAP_FAILED;
+    if (size) {
+        char path[PXSHOT_DISK_PATH_MAX];
+        struct stat st;
+        pxshot_disk_path(disk, id, path);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd >= 0 && fstat(fd, &st) == 0 && (uint64_t)st.st_size == size) {
+            /* Private and writable, so the caller may modify data as with any response */
+            map = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        }
+        if (fd >= 0) close(fd);
+        if (map == MAP_FAILED) {
+            /* The file went missing or changed underneath the index */
+            pthread_mutex_lock(&disk->lock);
+            slot = pxshot_disk_find(disk, k);
+            if (*slot && memcmp((*slot)->object->id, id, sizeof(id)) == 0) pxshot_disk_remove(disk, slot, true);
+            pthread_mutex_unlock(&disk->lock);
+        }
+    }
+    if (map == MAP_FAILED) {
+        atomic_fetch_add_explicit(&client->stat_disk_misses, 1, memory_order_relaxed);
+        return false;
+    }
+
+    pxshot_response_impl_t *impl = (pxshot_response_impl_t *)resp;
+    impl->map = map;
+    impl->map_len = (size_t)size;
+    resp->data = (uint8_t *)map;
+    resp->data_len = (size_t)size;
+    resp->error = PXSHOT_OK;
+    resp->http_status = 200;
+    resp->cached = true;
+    atomic_fetch_add_explicit(&client->stat_disk_hits, 1, memory_order_relaxed);
+    return true;
+}
+
+/* Write a file under a temporary name and rename it into place */
+static bool pxshot_disk_write(const char *path, const uint8_t *data, size_t len) {
+    char tmp[PXSHOT_DISK_PATH_MAX];
+    int tmp_len = snprintf(tmp, sizeof(tmp), "%s.%llx.tmp", path, (unsigned long long)pxshot_clock_ns());
+    if (tmp_len < 0 || (size_t)tmp_len >= sizeof(tmp)) return false;
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    bool ok = close(fd) == 0 && done == len && rename(tmp, path) == 0;
+    if (!ok) unlink(tmp);
+    return ok;
+}
+
+/* Store a successful image response; identical images share one file */
+static void pxshot_disk_put(pxshot_client_t *client, const char *key, const pxshot_response_t *resp) {
+    pxshot_disk_t *disk = client->disk;
+    if (resp->error != PXSHOT_OK || !resp->data || !resp->data_len || resp->stored || resp->cached) return;
+    if (resp->data_len > client->disk_cache.max_bytes) return;
+
+    uint64_t k[2], id[2];
+    pxshot_hash128(key, strlen(key), k);
+    pxshot_hash128(resp->data, resp->data_len, id);
+
+    char path[PXSHOT_DISK_PATH_MAX];
+    pxshot_disk_path(disk, id, path);
+
+    /*
+     * An image file is only deleted, with the lock held, when its last entry
+     * goes. So the entry is inserted in the same critical section that finds
+     * the image indexed, or the file just written still in place; an eviction
+     * in between could otherwise leave the entry without a file.
+     */
+    bool written = false;
+    pthread_mutex_lock(&disk->lock);
+    while (!*pxshot_disk_object_find(disk, id) && !(written && access(path, F_OK) == 0)) {
+        pthread_mutex_unlock(&disk->lock);
+        /* Deleted again before it could be indexed: leave this image uncached */
+        if (written) return;
+        char sub[PXSHOT_DISK_PATH_MAX];
+        snprintf(sub, sizeof(sub), "%s/objects/%02x", disk->dir, (unsigned)(id[0] >> 56));
+        if (mkdir(sub, 0755) != 0 && errno != EEXIST) return;
+        if (!pxshot_disk_write(path, resp->data, resp->data_len)) return;
+        written = true;
+        pthread_mutex_lock(&disk->lock);
+    }
+
+    int64_t now = pxshot_wall_ms();
+    pxshot_disk_entry_t *entry = pxshot_disk_insert(disk, k, id, resp->data_len, now, now);
+    if (entry) {
+        pxshot_disk_journal(disk, entry, k);
+        /* The new entry is the most recent and fits the quota alone, so it survives */
+        pxshot_disk_evict(client, disk, true);
+    }
+    pthread_mutex_unlock(&disk->lock);
+}
+
+/* Rate limiter */
+
+/* Read exactly n decimal digits */
+static bool pxshot_parse_digits(const char **p, int n, int *out) {
+    int v = 0;
+    for (int i = 0; i < n; i++, (*p)++) {
+        if (**p < '0' || **p > '9') return false;
+        v = v * 10 + (**p - '0');
+    }
+    *out = v;
+    return true;
+}
+
+/*
+ * Milliseconds since the epoch for an RFC 3339 timestamp
+ * (YYYY-MM-DDTHH:MM:SS[.frac](Z|+hh:mm|-hh:mm)), or -1 if it does not
+ * parse. A missing offset is taken as UTC; fractions finer than a
+ * millisecond are dropped.
+ */
+static int64_t pxshot_parse_time(const char *text) {
+    static const int month_days[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    const char *p = text;
+    int y, mo, d, h, mi, s, ms = 0, offset_min = 0;
+    if (!p || !pxshot_parse_digits(&p, 4, &y) || *p++ != '-' ||
+        !pxshot_parse_digits(&p, 2, &mo) || *p++ != '-' ||
+        !pxshot_parse_digits(&p, 2, &d)) return -1;
+    if (*p != 'T' && *p != 't') return -1;
+    p++;
+    if (!pxshot_parse_digits(&p, 2, &h) || *p++ != ':' ||
+        !pxshot_parse_digits(&p, 2, &mi) || *p++ != ':' ||
+        !pxshot_parse_digits(&p, 2, &s)) return -1;
+
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (mo < 1 || mo > 12 || d < 1 || d > month_days[mo - 1] || (mo == 2 && d == 29 && !leap) ||
+        h > 23 || mi > 59 || s > 60) return -1;
+
+    if (*p == '.') {
+        p++;
+        if (*p < '0' || *p > '9') return -1;
+        for (int scale = 100; *p >= '0' && *p <= '9'; p++, scale /= 10) ms += (*p - '0') * scale;
+    }
+
+    if (*p == 'Z' || *p == 'z') {
+        p++;
+    } else if (*p == '+' || *p == '-') {
+        int sign = *p++ == '-' ? -1 : 1, oh, om;
+        if (!pxshot_parse_digits(&p, 2, &oh) || *p++ != ':' || !pxshot_parse_digits(&p, 2, &om) ||
+            oh > 23 || om > 59) return -1;
+        offset_min = sign * (oh * 60 + om);
+    }
+    if (*p) return -1;
+
+    /* Days from civil date (proleptic Gregorian) */
+    y -= mo <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = era * 146097 + doe - 719468;
+    int64_t seconds = days * 86400 + h * 3600 + mi * 60 + s - (int64_t)offset_min * 60;
+    return seconds * 1000 + ms;
+}
+
+/* Retune the rate from plan usage: pace the remaining quota over the period */
+static void pxshot_limiter_calibrate(pxshot_client_t *client, const pxshot_usage_t *usage) {
+    if (!client->rate_limit.adaptive) return;
+
+    pxshot_limiter_t *l = &client->limiter;
+    atomic_store(&l->calibrate_at_ms, pxshot_clock_ms() + client->rate_limit.recalibrate_ms);
+    if (usage->screenshots_limit <= 0) return;
+
+    int64_t remaining = (int64_t)usage->screenshots_limit - usage->screenshots_used;
+    atomic_store(&l->exhausted, remaining <= 0);
+    if (remaining <= 0) return;
+
+    int64_t interval = l->base_interval_ns;
+    int64_t end_ms = pxshot_parse_time(usage->period_end);
+    int64_t left_ms = end_ms < 0 ? 0 : end_ms - pxshot_wall_ms();
+    if (left_ms > 0) {
+        int64_t pace = (int64_t)((double)left_ms * 1e6 / (double)remaining);
+        if (pace > interval) interval = pace;
+    }
+    atomic_store(&l->interval_ns, interval);
+}
+
+/* Re-read usage once recalibrate_ms has passed; one caller does it at a time */
+static void pxshot_limiter_refresh(pxshot_client_t *client) {
+    if (!client->rate_limit.adaptive) return;
+
+    int64_t now = pxshot_clock_ms();
+    int64_t due = atomic_load(&client->limiter.calibrate_at_ms);
+    if (now < due || !atomic_compare_exchange_strong(&client->limiter.calibrate_at_ms, &due,
+                                                     now + client->rate_limit.recalibrate_ms)) {
+        return;
+    }
+
+    pxshot_usage_t *usage = NULL;
+    pxshot_response_free(pxshot_get_usage(client, &usage));
+    pxshot_usage_free(usage);
+}
+
+/*
+ * Take a token. *wait_ms is how long the caller must hold the request
+ * before sending it. Fails without taking a token when the caller may not
+ * wait that long: fail_fast (or no_wait) is set, or the guard's deadline
+ * falls first.
+ */
+static pxshot_error_t pxshot_limiter_reserve(pxshot_client_t *client, const pxshot_guard_t *guard,
+                                             bool no_wait, uint64_t *wait_ms) {
+    pxshot_limiter_t *l = &client->limiter;
+    *wait_ms = 0;
+    if (atomic_load(&l->exhausted)) {
+        atomic_fetch_add_explicit(&l->rejected, 1, memory_order_relaxed);
+        return PXSHOT_ERR_RATE_LIMITED;
+    }
+    int64_t interval = atomic_load(&l->interval_ns);
+    if (interval == 0) return PXSHOT_OK;
+
+    int64_t now = (int64_t)pxshot_clock_ns();
+    int64_t tat = atomic_load(&l->tat_ns);
+    int64_t wait;
+    for (;;) {
+        int64_t next = (tat > now ? tat : now) + interval;
+        wait = next - l->burst * interval - now;
+        if (wait > 0) {
+            if (no_wait || client->rate_limit.fail_fast) {
+                atomic_fetch_add_explicit(&l->rejected, 1, memory_order_relaxed);
+                return PXSHOT_ERR_RATE_LIMITED;
+            }
+            if (guard && guard->deadline_ms &&
+                (uint64_t)(now + wait) / 1000000u >= guard->deadline_ms) {
+                return PXSHOT_ERR_DEADLINE;
+            }
+        }
+        if (atomic_compare_exchange_weak(&l->tat_ns, &tat, next)) break;
+    }
+
+    if (wait > 0) {
+        *wait_ms = (uint64_t)(wait + 999999) / 1000000u;
+        atomic_fetch_add_explicit(&l->delayed, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&l->delay_ms, *wait_ms, memory_order_relaxed);
+    }
+    return PXSHOT_OK;
+}
+
+static const char *pxshot_limiter_message(const pxshot_client_t *client, pxshot_error_t err) {
+    if (err != PXSHOT_ERR_RATE_LIMITED) return pxshot_guard_message(err);
+    return atomic_load(&client->limiter.exhausted) ? "plan quota exhausted" : "client rate limit reached";
+}
+
+/* Stored-result reuse */
+
+static pxshot_stored_entry_t **pxshot_stored_find(pxshot_client_t *client, uint64_t hash, const char *key) {
+    pxshot_stored_entry_t **slot = &client->stored_buckets[hash % PXSHOT_STORED_BUCKETS];
+    while (*slot && ((*slot)->hash != hash || strcmp((*slot)->key, key) != 0)) slot = &(*slot)->chain;
+    return slot;
+}
+
+static void pxshot_stored_lru_unlink(pxshot_client_t *client, pxshot_stored_entry_t *entry) {
+    if (entry->prev) entry->prev->next = entry->next;
+    else client->stored_head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else client->stored_tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+static void pxshot_stored_lru_push(pxshot_client_t *client, pxshot_stored_entry_t *entry) {
+    entry->prev = NULL;
+    entry->next = client->stored_head;
+    if (client->stored_head) client->stored_head->prev = entry;
+    else client->stored_tail = entry;
+    client->stored_head = entry;
+}
+
+/* Unlink and free an entry with stored_lock held */
+static void pxshot_stored_remove(pxshot_client_t *client, pxshot_stored_entry_t **slot) {
+    pxshot_stored_entry_t *entry = *slot;
+    *slot = entry->chain;
+    pxshot_stored_lru_unlink(client, entry);
+    client->stored_count--;
+    pxshot_mem_free(client->alloc, entry);
+}
+
+/* Fill resp with a remembered stored result that is still valid; returns false otherwise */
+static bool pxshot_stored_get(pxshot_client_t *client, const char *key, uint64_t hash,
+                              pxshot_response_t *resp) {
+    int64_t now = pxshot_wall_ms();
+    pthread_mutex_lock(&client->stored_lock);
+    pxshot_stored_entry_t **slot = pxshot_stored_find(client, hash, key);
+    if (*slot && (*slot)->expires_ms - client->stored_reuse.margin_ms <= now) {
+        pxshot_stored_remove(client, slot);
+    } else if (*slot) {
+        pxshot_stored_lru_unlink(client, *slot);
+        pxshot_stored_lru_push(client, *slot);
+        if (!pxshot_response_set_stored(resp, &(*slot)->stored)) pxshot_response_clear(resp);
+    }
+    pthread_mutex_unlock(&client->stored_lock);
+
+    if (!resp->stored) return false;
+    resp->error = PXSHOT_OK;
+    resp->http_status = 200;
+    resp->cached = true;
+    atomic_fetch_add_explicit(&client->stat_stored_hits, 1, memory_order_relaxed);
+    return true;
+}
+
+/* Remember a successful stored result, parsing its expiry once */
+static void pxshot_stored_put(pxshot_client_t *client, const char *key, uint64_t hash,
+                              const pxshot_response_t *resp) {
+    if (resp->error != PXSHOT_OK || !resp->stored || !resp->stored->url || resp->cached) return;
+    int64_t expires_ms = pxshot_parse_time(resp->stored->expires_at);
+    if (expires_ms < 0) return;
+    if (expires_ms - client->stored_reuse.margin_ms <= pxshot_wall_ms()) return;
+
+    size_t key_len = strlen(key) + 1;
+    size_t url_len = strlen(resp->stored->url) + 1;
+    size_t expires_len = strlen(resp->stored->expires_at) + 1;
+    pxshot_stored_entry_t *entry = (pxshot_stored_entry_t *)pxshot_mem_alloc(
+        client->alloc, sizeof(pxshot_stored_entry_t) + key_len + url_len + expires_len);
+    if (!entry) return;
+    entry->hash = hash;
+    entry->key = memcpy(entry->text, key, key_len);
+    entry->stored = *resp->stored;
+    entry->stored.url = memcpy(entry->text + key_len, resp->stored->url, url_len);
+    entry->stored.expires_at = memcpy(entry->text + key_len + url_len, resp->stored->expires_at, expires_len);
+    entry->expires_ms = expires_ms;
+
+    pthread_mutex_lock(&client->stored_lock);
+    pxshot_stored_entry_t **slot = pxshot_stored_find(client, hash, key);
+    if (*slot) pxshot_stored_remove(client, slot);
+    while (client->stored_count >= client->stored_reuse.max_entries && client->stored_tail) {
+        pxshot_stored_entry_t *victim = client->stored_tail;
+        pxshot_stored_remove(client, pxshot_stored_find(client, victim->hash, victim->key));
+    }
+    slot = &client->stored_buckets[hash % PXSHOT_STORED_BUCKETS];
+    entry->chain = *slot;
+    *slot = entry;
+    pxshot_stored_lru_push(client, entry);
+    client->stored_count++;
+    pthread_mutex_unlock(&client->stored_lock);
+}
+
+static void pxshot_stored_destroy(pxshot_client_t *client) {
+    while (client->stored_head) {
+        pxshot_stored_entry_t *entry = client->stored_head;
+        pxshot_stored_remove(client, pxshot_stored_find(client, entry->hash, entry->key));
+    }
+}
+
+/* Whether results for opts go through the caches (or the stored-result index) */
+static bool pxshot_cacheable(const pxshot_client_t *client, const pxshot_screenshot_opts_t *opts) {
+    if (opts->store) return client->stored_reuse.max_entries > 0;
+    return client->cache_shards || client->disk;
+}
+
+/* Look in the memory cache, then on disk; stored captures in the stored-result index */
+static bool pxshot_cache_lookup(pxshot_client_t *client, const char *key, uint64_t hash, bool store,
+                                pxshot_response_t *resp) {
+    if (store) return pxshot_stored_get(client, key, hash, resp);
+    if (client->cache_shards && pxshot_cache_get(client, key, hash, resp)) return true;
+    return client->disk && pxshot_disk_get(client, key, resp);
+}
+
+static void pxshot_cache_store(pxshot_client_t *client, const char *key, uint64_t hash,
+                               pxshot_response_t *resp) {
+    if (resp->stored) {
+        pxshot_stored_put(client, key, hash, resp);
+        return;
+    }
+    if (client->disk) pxshot_disk_put(client, key, resp);
+    if (client->cache_shards) pxshot_cache_put(client, key, hash, resp);
+}
+
+/* Adaptive concurrency limit */
+
+/* Transient failures and timeouts: back off by this factor */
+#define PXSHOT_CLIMIT_BACKOFF 0.9
+
+/* Headroom added on each update; the limit probes upward by this much */
+#define PXSHOT_CLIMIT_QUEUE 4
+
+/* Samples averaged before the baseline switches to a slow EMA */
+#define PXSHOT_CLIMIT_WARMUP 10
+
+static void pxshot_climit_sample(pxshot_client_t *client, const pxshot_response_t *resp,
+                                 double rtt_ms, size_t active) {
+    if (!client->concurrency.adaptive) return;
+    if (resp->error == PXSHOT_ERR_CANCELLED || resp->error == PXSHOT_ERR_DEADLINE) return;
+
+    const pxshot_concurrency_policy_t *policy = &client->concurrency;
+    pxshot_climit_t *c = &client->climit;
+    if (resp->retryable) {
+        c->limit *= PXSHOT_CLIMIT_BACKOFF;
+        if (c->limit < policy->min_limit) c->limit = policy->min_limit;
+        c->backoffs++;
+        return;
+    }
+
+    c->samples++;
+    if (c->samples == 1) {
+        c->rtt_short = c->rtt_long = rtt_ms;
+    } else {
+        c->rtt_short += (rtt_ms - c->rtt_short) * (2.0 / 11.0);
+        /*
+         * The baseline is the no-queueing latency, so it does not absorb a
+         * rise while requests queue; at the floor the rise is the service's
+         * own and the baseline follows it.
+         */
+        bool queueing = c->rtt_short > policy->rtt_tolerance * c->rtt_long &&
+                        c->limit > policy->min_limit;
+        if (c->samples <= PXSHOT_CLIMIT_WARMUP) {
+            c->rtt_long += (rtt_ms - c->rtt_long) / (double)c->samples;
+        } else if (!queueing) {
+            c->rtt_long += (rtt_ms - c->rtt_long) * (2.0 / 601.0);
+        }
+    }
+    /* Let the baseline follow latency back down after a sustained rise */
+    if (c->rtt_long > c->rtt_short * 2) c->rtt_long *= 0.95;
+
+    /* Only grow when the limit is actually what holds requests back */
+    if ((double)active < c->limit / 2) return;
+
+    double gradient = policy->rtt_tolerance * c->rtt_long / c->rtt_short;
+    if (gradient > 1.0) gradient = 1.0;
+    if (gradient < 0.5) gradient = 0.5;
+    double target = c->limit * gradient + PXSHOT_CLIMIT_QUEUE;
+    c->limit = c->limit * (1 - policy->smoothing) + target * policy->smoothing;
+    if (c->limit < policy->min_limit) c->limit = policy->min_limit;
+    if (c->limit > policy->max_limit) c->limit = policy->max_limit;
+}
+
+/* Latency history */
+
+static int pxshot_u32_compare(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Record a completed request's latency; the threshold is refreshed every 16 samples */
+static void pxshot_latency_record(pxshot_client_t *client, uint64_t ms) {
+    pxshot_latency_t *lat = &client->latency;
+    pthread_mutex_lock(&lat->lock);
+    lat->samples[lat->next] = ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+    lat->next = (lat->next + 1) % PXSHOT_LATENCY_SAMPLES;
+    if (lat->count < PXSHOT_LATENCY_SAMPLES) lat->count++;
+
+    if (lat->count >= (size_t)client->hedge.min_samples &&
+        (++lat->since_update >= 16 || lat->threshold_ms < 0)) {
+        uint32_t sorted[PXSHOT_LATENCY_SAMPLES];
+        memcpy(sorted, lat->samples, lat->count * sizeof(uint32_t));
+        qsort(sorted, lat->count, sizeof(uint32_t), pxshot_u32_compare);
+        long at = (long)sorted[(size_t)(client->hedge.percentile * (double)(lat->count - 1))];
+        lat->threshold_ms = at > client->hedge.min_delay_ms ? at : client->hedge.min_delay_ms;
+        lat->since_update = 0;
+    }
+    pthread_mutex_unlock(&lat->lock);
+}
+
+static long pxshot_latency_threshold(pxshot_client_t *client) {
+    pthread_mutex_lock(&client->latency.lock);
+    long threshold = client->latency.threshold_ms;
+    pthread_mutex_unlock(&client->latency.lock);
+    return threshold;
+}
+
+/* Expected remaining latency of a request still running after elapsed_ms */
+static uint64_t pxshot_latency_excess(pxshot_client_t *client, uint64_t elapsed_ms) {
+    pxshot_latency_t *lat = &client->latency;
+    uint64_t sum = 0;
+    uint64_t n = 0;
+    pthread_mutex_lock(&lat->lock);
+    for (size_t i = 0; i < lat->count; i++) {
+        if (lat->samples[i] > elapsed_ms) {
+            sum += lat->samples[i] - elapsed_ms;
+            n++;
+        }
+    }
+    pthread_mutex_unlock(&lat->lock);
+    return n ? sum / n : 0;
+}
+
+/* Duplicate attempt of a blocking screenshot, sent when the original stalls */
+typedef struct {
+    pxshot_client_t *client;
+    const char *body;
+    long after_ms;                  /* Send after this long without a response (-1 = never) */
+    pxshot_conn_t *conn;            /* Hedge handle once sent */
+    pxshot_buffer_t buffer;
+    uint64_t sent_ms;
+    bool won;                       /* The hedge finished first */
+} pxshot_hedge_t;
+
+static void pxshot_hedge_send(pxshot_hedge_t *hedge, pxshot_conn_t *primary, pxshot_guard_t *guard) {
+    pxshot_client_t *client = hedge->client;
+    uint64_t wait_ms;
+    if (!pxshot_budget_withdraw(&client->hedge_budget) ||
+        pxshot_limiter_reserve(client, NULL, true, &wait_ms) != PXSHOT_OK) {
+        atomic_fetch_add_explicit(&client->stat_hedges_throttled, 1, memory_order_relaxed);
+        return;
+    }
+
+    pxshot_conn_t *conn = pxshot_pool_try_acquire(&client->pool);
+    if (!conn) return;
+    pxshot_setup_screenshot(client, conn, hedge->body, &hedge->buffer);
+    pxshot_conn_guard(client, conn, guard);
+    if (curl_multi_add_handle(primary->multi, conn->curl) != CURLM_OK) {
+        pxshot_pool_release(&client->pool, conn);
+        return;
+    }
+    hedge->conn = conn;
+    hedge->sent_ms = (uint64_t)pxshot_clock_ms();
+    atomic_fetch_add_explicit(&client->stat_hedges, 1, memory_order_relaxed);
+}
+
+/*
+ * Run a blocking transfer. Equivalent to curl_easy_perform(), but driven
+ * through the handle's own multi handle so a guarded request is checked
+ * every PXSHOT_GUARD_POLL_MS instead of only when the progress callback
+ * runs, which libcurl may delay by a second on an idle transfer.
+ *
+ * With a hedge, a duplicate is sent on the same multi handle once the
+ * transfer has had no response for hedge->after_ms, and the first to
+ * finish decides the result. A transport failure only counts once the
+ * other attempt has finished too.
+ */
+static CURLcode pxshot_conn_perform(pxshot_conn_t *conn, pxshot_guard_t *guard, pxshot_hedge_t *hedge) {
+    if (!conn->multi && !(conn->multi = curl_multi_init())) return CURLE_OUT_OF_MEMORY;
+    if (curl_multi_add_handle(conn->multi, conn->curl) != CURLM_OK) return CURLE_FAILED_INIT;
+
+    bool guarded = pxshot_guard_active(guard);
+    uint64_t start = (uint64_t)pxshot_clock_ms();
+    CURLcode res = CURLE_FAILED_INIT;
+    for (;;) {
+        int running = 0;
+        if (curl_multi_perform(conn->multi, &running) != CURLM_OK) break;
+
+        bool finished = false;
+        CURLMsg *msg;
+        int queued;
+        while ((msg = curl_multi_info_read(conn->multi, &queued))) {
+            if (msg->msg != CURLMSG_DONE || finished) continue;
+            res = msg->data.result;
+            if (res != CURLE_OK && running > 0) continue;
+            finished = true;
+            if (hedge) hedge->won = hedge->conn && msg->easy_handle == hedge->conn->curl;
+        }
+        if (finished || !running) break;
+
+        if (guarded && (guard->reason = pxshot_guard_check(guard)) != PXSHOT_OK) {
+            res = CURLE_ABORTED_BY_CALLBACK;
+            break;
+        }
+
+        int wait_ms = guarded ? PXSHOT_GUARD_POLL_MS : 1000;
+        if (hedge && hedge->after_ms >= 0) {
+            long elapsed = (long)((uint64_t)pxshot_clock_ms() - start);
+            if (elapsed >= hedge->after_ms) {
+                long status = 0;
+                curl_easy_getinfo(conn->curl, CURLINFO_RESPONSE_CODE, &status);
+                if (status == 0) pxshot_hedge_send(hedge, conn, guard);
+                hedge->after_ms = -1;
+            } else if (hedge->after_ms - elapsed < wait_ms) {
+                wait_ms = (int)(hedge->after_ms - elapsed);
+            }
+        }
+        if (curl_multi_poll(conn->multi, NULL, 0, wait_ms, NULL) != CURLM_OK) break;
+    }
+
+    curl_multi_remove_handle(conn->multi, conn->curl);
+    if (hedge && hedge->conn) curl_multi_remove_handle(conn->multi, hedge->conn->curl);
+    return res;
+}
+
+/* Transport failures worth another attempt */
+static bool pxshot_curl_retryable(CURLcode res) {
+    switch (res) {
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* HTTP statuses worth another attempt */
+static bool pxshot_http_retryable(long status) {
+    return status == 408 || status == 429 || status == 500 ||
+           status == 502 || status == 503 || status == 504;
+}
+
+/*
+ * Turn a finished screenshot transfer into a response.
+ * Takes ownership of buffer->data.
+ */
+static void pxshot_screenshot_result(pxshot_response_t *resp, CURL *curl, CURLcode res,
+                                     pxshot_buffer_t *buffer, bool store,
+                                     const pxshot_guard_t *guard) {
+    resp->attempts++;
+    resp->reallocs = buffer->reallocs;
+    if (res != CURLE_OK) {
+        pxshot_buffer_free(buffer);
+        resp->retryable = pxshot_curl_retryable(res);
+        pxshot_error_t reason = guard->reason;
+        if (reason == PXSHOT_OK && res == CURLE_OPERATION_TIMEDOUT && guard->deadline_bound) {
+            reason = PXSHOT_ERR_DEADLINE;
+        }
+        if (reason != PXSHOT_OK) {
+            resp->retryable = false;
+            pxshot_set_error(resp, reason, pxshot_guard_message(reason));
+        } else if (res == CURLE_OPERATION_TIMEDOUT) {
+            pxshot_set_error(resp, PXSHOT_ERR_TIMEOUT, curl_easy_strerror(res));
+        } else {
+            pxshot_set_error(resp, PXSHOT_ERR_CURL_PERFORM, curl_easy_strerror(res));
+        }
+        return;
+    }
+
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    resp->http_status = (int)http_code;
+
+    if (http_code >= 400) {
+        /* Try to parse error message from JSON */
+        pxshot_reader_t r;
+        pxshot_reader_str_t key, msg = {0};
+        pxshot_reader_object(&r, buffer->data, buffer->len);
+        while (pxshot_reader_key(&r, &key)) {
+            if (PXSHOT_KEY_IS(&key, "error")) pxshot_reader_get_string(&r, &msg);
+            else pxshot_reader_skip(&r);
+        }
+        if (!r.failed) resp->error_message = pxshot_response_json_string(resp, &msg);
+        pxshot_buffer_free(buffer);
+        resp->error = PXSHOT_ERR_HTTP_ERROR;
+        resp->retryable = pxshot_http_retryable(http_code);
+        if (!resp->error_message) resp->error_message = pxshot_response_strdup(resp, "HTTP error");
+        return;
+    }
+
+    /* Check if response is JSON (stored) or binary (image) */
+    char *content_type = NULL;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &content_type);
+
+    if (store || (content_type && strstr(content_type, "application/json"))) {
+        /* Parse stored response */
+        pxshot_reader_t r;
+        pxshot_reader_str_t key, url = {0}, expires_at = {0};
+        double width = 0, height = 0, size_bytes = 0;
+        pxshot_reader_object(&r, buffer->data, buffer->len);
+        while (pxshot_reader_key(&r, &key)) {
+            if (PXSHOT_KEY_IS(&key, "url")) pxshot_reader_get_string(&r, &url);
+            else if (PXSHOT_KEY_IS(&key, "expires_at")) pxshot_reader_get_string(&r, &expires_at);
+            else if (PXSHOT_KEY_IS(&key, "width")) pxshot_reader_get_number(&r, &width);
+            else if (PXSHOT_KEY_IS(&key, "height")) pxshot_reader_get_number(&r, &height);
+            else if (PXSHOT_KEY_IS(&key, "size_bytes")) pxshot_reader_get_number(&r, &size_bytes);
+            else pxshot_reader_skip(&r);
+        }
+
+        if (r.failed) {
+            pxshot_buffer_free(buffer);
+            pxshot_set_error(resp, PXSHOT_ERR_JSON_PARSE, "failed to parse response JSON");
+            return;
+        }
+
+        /* The strings point into the buffer until they are copied out */
+        pxshot_stored_t *stored = pxshot_response_stored(resp);
+        stored->url = pxshot_response_json_string(resp, &url);
+        stored->expires_at = pxshot_response_json_string(resp, &expires_at);
+        stored->width = pxshot_reader_int(width);
+        stored->height = pxshot_reader_int(height);
+        stored->size_bytes = size_bytes <= 0 ? 0 : size_bytes >= (double)SIZE_MAX ? SIZE_MAX : (size_t)size_bytes;
+        pxshot_buffer_free(buffer);
+    } else {
+        /* Binary image data */
+        resp->data = buffer->data;
+        resp->data_len = buffer->len;
+        if (buffer->pool && buffer->data) {
+            pxshot_response_impl_t *impl = (pxshot_response_impl_t *)resp;
+            impl->pool = pxshot_bufpool_retain(buffer->pool);
+            impl->cap = buffer->cap;
+        }
+    }
+
+    resp->error = PXSHOT_OK;
+}
+
+static void pxshot_async_abort_all(pxshot_client_t *client);
+
+/* Public API Implementation */
+
+pxshot_client_t *pxshot_new(const char *api_key) {
+    pxshot_config_t config = {
+        .api_key = api_key,
+        .base_url = NULL,
+        .timeout_ms = 0
+    };
+    return pxshot_new_with_config(&config);
+}
+
+pxshot_client_t *pxshot_new_with_config(const pxshot_config_t *config) {
+    if (!config || !config->api_key) return NULL;
+
+    pthread_once(&pxshot_global_once, pxshot_global_init);
+
+    const pxshot_allocator_t *alloc = config->allocator ? config->allocator : pxshot_global_allocator;
+    if (!alloc->malloc_fn || !alloc->realloc_fn || !alloc->free_fn) return NULL;
+    pxshot_client_t *client = (pxshot_client_t *)pxshot_mem_calloc(alloc, 1, sizeof(pxshot_client_t));
+    if (!client) return NULL;
+    client->alloc = alloc;
+    pthread_mutex_init(&client->latency.lock, NULL);
+    client->latency.threshold_ms = -1;
+    pthread_mutex_init(&client->flight_lock, NULL);
+    pthread_cond_init(&client->flight_landed, NULL);
+    pthread_mutex_init(&client->stored_lock, NULL);
+    for (int i = 0; i <= PXSHOT_API_USAGE; i++) {
+        pthread_mutex_init(&client->breakers[i].lock, NULL);
+    }
+
+    client->api_key = pxshot_strdup(alloc, config->api_key);
+    client->base_url = pxshot_strdup(alloc, config->base_url ? config->base_url : PXSHOT_DEFAULT_BASE_URL);
+    client->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 30000;
+    client->http2 = config->http2;
+    if (config->ca_file) client->ca_file = pxshot_strdup(alloc, config->ca_file);
+
+    client->retry = config->retry;
+    if (client->retry.max_attempts < 1) client->retry.max_attempts = 1;
+    if (client->retry.base_delay_ms <= 0) client->retry.base_delay_ms = 100;
+    if (client->retry.max_delay_ms <= 0) client->retry.max_delay_ms = 10000;
+    if (client->retry.max_delay_ms < client->retry.base_delay_ms) {
+        client->retry.max_delay_ms = client->retry.base_delay_ms;
+    }
+    if (client->retry.budget_ratio <= 0) client->retry.budget_ratio = 0.1;
+    if (client->retry.budget_max <= 0) client->retry.budget_max = 10;
+    pxshot_budget_init(&client->retry_budget, client->retry.budget_ratio, client->retry.budget_max);
+
+    client->hedge = config->hedge;
+    if (client->hedge.percentile < 0) client->hedge.percentile = 0;
+    if (client->hedge.percentile > 1) client->hedge.percentile = 1;
+    if (client->hedge.min_delay_ms <= 0) client->hedge.min_delay_ms = 20;
+    if (client->hedge.max_rate <= 0) client->hedge.max_rate = 0.05;
+    if (client->hedge.min_samples <= 0) client->hedge.min_samples = 20;
+    if (client->hedge.min_samples > PXSHOT_LATENCY_SAMPLES) client->hedge.min_samples = PXSHOT_LATENCY_SAMPLES;
+    pxshot_budget_init(&client->hedge_budget, client->hedge.max_rate, 10);
+
+    client->circuit = config->circuit;
+    if (client->circuit.failure_ratio > 1) client->circuit.failure_ratio = 1;
+    if (client->circuit.min_requests <= 0) client->circuit.min_requests = 20;
+    if (client->circuit.window_ms < PXSHOT_BREAKER_BUCKETS) client->circuit.window_ms = 10000;
+    if (client->circuit.slow_call_ms < 0) client->circuit.slow_call_ms = 0;
+    if (client->circuit.open_ms <= 0) client->circuit.open_ms = 5000;
+    if (client->circuit.half_open_probes <= 0) client->circuit.half_open_probes = 1;
+
+    client->rate_limit = config->rate_limit;
+    if (client->rate_limit.burst <= 0) client->rate_limit.burst = 10;
+    if (client->rate_limit.recalibrate_ms <= 0) client->rate_limit.recalibrate_ms = 300000;
+    client->limiter.burst = client->rate_limit.burst;
+    if (client->rate_limit.requests_per_sec > 0) {
+        client->limiter.base_interval_ns = (int64_t)(1e9 / client->rate_limit.requests_per_sec);
+        if (client->limiter.base_interval_ns < 1) client->limiter.base_interval_ns = 1;
+    }
+    atomic_init(&client->limiter.interval_ns, client->limiter.base_interval_ns);
+
+    client->concurrency = config->concurrency;
+    if (client->concurrency.max_limit <= 0) client->concurrency.max_limit = 200;
+    if (client->concurrency.min_limit <= 0) client->concurrency.min_limit = 1;
+    if (client->concurrency.min_limit > client->concurrency.max_limit) {
+        client->concurrency.min_limit = client->concurrency.max_limit;
+    }
+    if (client->concurrency.initial_limit <= 0) client->concurrency.initial_limit = 20;
+    if (client->concurrency.initial_limit < client->concurrency.min_limit) {
+        client->concurrency.initial_limit = client->concurrency.min_limit;
+    }
+    if (client->concurrency.initial_limit > client->concurrency.max_limit) {
+        client->concurrency.initial_limit = client->concurrency.max_limit;
+    }
+    if (client->concurrency.rtt_tolerance < 1) client->concurrency.rtt_tolerance = 1.5;
+    if (client->concurrency.smoothing <= 0 || client->concurrency.smoothing > 1) {
+        client->concurrency.smoothing = 0.2;
+    }
+    client->climit.limit = client->concurrency.initial_limit;
+
+    client->coalesce = config->coalesce;
+
+    if (config->buffer_pool.max_bytes > 0) {
+        client->bufpool = pxshot_bufpool_new(alloc, config->buffer_pool.max_bytes);
+        if (!client->bufpool) {
+            pxshot_free(client);
+            return NULL;
+        }
+    }
+
+    client->cache = config->cache;
+    if (client->cache.max_bytes > 0) {
+        if (client->cache.ttl_ms <= 0) client->cache.ttl_ms = 300000;
+        if (client->cache.shards <= 0) client->cache.shards = 16;
+        client->cache_shards = (pxshot_cache_shard_t *)pxshot_mem_calloc(client->alloc, (size_t)client->cache.shards,
+                                                                         sizeof(pxshot_cache_shard_t));
+        if (!client->cache_shards) {
+            pxshot_free(client);
+            return NULL;
+        }
+        for (int i = 0; i < client->cache.shards; i++) {
+            pthread_mutex_init(&client->cache_shards[i].lock, NULL);
+        }
+        client->cache_shard_bytes = client->cache.max_bytes / (size_t)client->cache.shards;
+    }
+
+    client->disk_cache = config->disk_cache;
+    if (client->disk_cache.dir) {
+        if (client->disk_cache.max_bytes == 0) client->disk_cache.max_bytes = (uint64_t)1 << 30;
+        if (client->disk_cache.ttl_ms <= 0) client->disk_cache.ttl_ms = 86400000;
+        client->disk = pxshot_disk_open(client);
+        if (!client->disk) {
+            pxshot_free(client);
+            return NULL;
+        }
+        client->disk_cache.dir = client->disk->dir;
+    }
+
+    client->stored_reuse = config->stored_reuse;
+    if (client->stored_reuse.margin_ms <= 0) client->stored_reuse.margin_ms = 60000;
+
+    atomic_init(&client->rng_state, pxshot_clock_ns() ^ (uint64_t)(uintptr_t)client);
+    client->share = pxshot_share_retain(config->share);
+
+    if (!client->api_key || !client->base_url || (config->ca_file && !client->ca_file)) {
+        pxshot_free(client);
+        return NULL;
+    }
+
+    /* Endpoint URLs and header lists are reused by every request */
+    client->screenshot_url = pxshot_endpoint_url(client, "/v1/screenshot");
+    client->usage_url = pxshot_endpoint_url(client, "/v1/usage");
+    client->json_headers = pxshot_request_headers(client, true);
+    client->auth_headers = pxshot_request_headers(client, false);
+    if (!client->screenshot_url || !client->usage_url ||
+        !client->json_headers || !client->auth_headers) {
+        pxshot_free(client);
+        return NULL;
+    }
+
+    size_t pool_size = config->pool_size > 0 ? config->pool_size : 1;
+    size_t pool_max = config->pool_max > 0 ? config->pool_max : 16;
+    if (pool_max < pool_size) pool_max = pool_size;
+
+    client->pool_ready = pxshot_pool_init(&client->pool, client->alloc, pool_size, pool_max,
+                                          pxshot_conn_setup, client);
+    client->multi = curl_multi_init();
+    if (!client->pool_ready || !client->multi) {
+        pxshot_free(client);
+        return NULL;
+    }
+    if (client->http2) {
+        curl_multi_setopt(client->multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    }
+
+    return client;
+}
+
+void pxshot_free(pxshot_client_t *client) {
+    if (!client) return;
+    pxshot_async_abort_all(client);
+    if (client->multi) curl_multi_cleanup(client->multi);
+    if (client->pool_ready) pxshot_pool_destroy(&client->pool);
+    pxshot_share_free(client->share);
+    curl_slist_free_all(client->json_headers);
+    curl_slist_free_all(client->auth_headers);
+    pxshot_mem_free(client->alloc, client->screenshot_url);
+    pxshot_mem_free(client->alloc, client->usage_url);
+    pxshot_mem_free(client->alloc, client->api_key);
+    pxshot_mem_free(client->alloc, client->base_url);
+    pxshot_mem_free(client->alloc, client->ca_file);
+    pthread_mutex_destroy(&client->latency.lock);
+    pthread_mutex_destroy(&client->flight_lock);
+    pthread_cond_destroy(&client->flight_landed);
+    pxshot_cache_destroy(client);
+    pxshot_disk_close(client->disk);
+    pxshot_stored_destroy(client);
+    pthread_mutex_destroy(&client->stored_lock);
+    if (client->bufpool) {
+        /* Responses still out keep the pool alive; their buffers are freed, not kept */
+        atomic_store(&client->bufpool->closed, true);
+        pxshot_bufpool_drain(client->bufpool);
+        pxshot_bufpool_release(client->bufpool);
+    }
+    for (int i = 0; i <= PXSHOT_API_USAGE; i++) {
+        pthread_mutex_destroy(&client->breakers[i].lock);
+    }
+    pxshot_mem_free(client->alloc, client);
+}
+
+/* Retry backoff */
+
+/* splitmix64 over a shared counter; lock-free and good enough for jitter */
+static uint64_t pxshot_random(pxshot_client_t *client) {
+    uint64_t z = atomic_fetch_add_explicit(&client->rng_state, 0x9e3779b97f4a7c15ULL,
+                                           memory_order_relaxed) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Decorrelated jitter: uniform in [base, 3 * previous delay], capped */
+static long pxshot_retry_delay(pxshot_client_t *client, long prev_ms) {
+    long lo = client->retry.base_delay_ms;
+    long hi = prev_ms * 3;
+    if (hi < lo) hi = lo;
+    long delay = lo + (long)(pxshot_random(client) % (uint64_t)(hi - lo + 1));
+    return delay < client->retry.max_delay_ms ? delay : client->retry.max_delay_ms;
+}
+
+/* Sleep between attempts; wakes early with the guard's error if it trips */
+static pxshot_error_t pxshot_backoff_sleep(const pxshot_guard_t *guard, long delay_ms) {
+    uint64_t until = (uint64_t)pxshot_clock_ms() + (uint64_t)delay_ms;
+    for (;;) {
+        pxshot_error_t stop = pxshot_guard_active(guard) ? pxshot_guard_check(guard) : PXSHOT_OK;
+        if (stop != PXSHOT_OK) return stop;
+        uint64_t now = (uint64_t)pxshot_clock_ms();
+        if (now >= until) return PXSHOT_OK;
+
+        uint64_t slice = until - now;
+        if (pxshot_guard_active(guard) && slice > PXSHOT_GUARD_POLL_MS) slice = PXSHOT_GUARD_POLL_MS;
+        struct timespec ts = { (time_t)(slice / 1000), (long)(slice % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+}
+
+/*
+ * Decide whether a failed attempt is retried and how long to wait first.
+ * Returns the delay, or -1 to give up.
+ */
+static long pxshot_retry_plan(pxshot_client_t *client, CURL *curl, const pxshot_response_t *resp,
+                              const pxshot_guard_t *guard, long prev_ms) {
+    if (!resp->retryable || resp->attempts >= client->retry.max_attempts) return -1;
+
+    long delay = pxshot_retry_delay(client, prev_ms);
+    curl_off_t retry_after = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) {
+        if (retry_after * 1000 > client->retry.max_delay_ms) return -1;
+        if (retry_after * 1000 > delay) delay = (long)(retry_after * 1000);
+    }
+    if (guard->deadline_ms && (uint64_t)pxshot_clock_ms() + (uint64_t)delay >= guard->deadline_ms) return -1;
+
+    if (!pxshot_budget_withdraw(&client->retry_budget)) {
+        atomic_fetch_add_explicit(&client->stat_retries_throttled, 1, memory_order_relaxed);
+        return -1;
+    }
+    return delay;
+}
+
+/* Request coalescing */
+
+static pxshot_flight_t **pxshot_flight_slot(pxshot_client_t *client, uint64_t hash, const char *key) {
+    pxshot_flight_t **slot = &client->flights[hash % PXSHOT_FLIGHT_BUCKETS];
+    while (*slot && ((*slot)->hash != hash || strcmp((*slot)->key, key) != 0)) slot = &(*slot)->next;
+    return slot;
+}
+
+/* Drop a reference with flight_lock held; the last one frees the flight */
+static void pxshot_flight_unref(pxshot_client_t *client, pxshot_flight_t *flight) {
+    if (--flight->refs > 0) return;
+    pxshot_response_free(flight->result);
+    pxshot_mem_free(client->alloc, flight->key);
+    pxshot_mem_free(client->alloc, flight);
+}
+
+/* Copy a published outcome into a follower's response, sharing the image bytes */
+static void pxshot_flight_copy(const pxshot_response_t *from, pxshot_response_t *to) {
+    to->error = from->error;
+    to->http_status = from->http_status;
+    to->retryable = from->retryable;
+    if (from->error_message) to->error_message = pxshot_response_strdup(to, from->error_message);
+    pxshot_blob_t *blob = ((const pxshot_response_impl_t *)from)->blob;
+    if (blob) pxshot_response_attach(to, blob);
+    if (from->stored) {
+        if (!pxshot_response_set_stored(to, from->stored)) {
+            pxshot_response_clear(to);
+            pxshot_set_error(to, PXSHOT_ERR_OUT_OF_MEMORY, "failed to allocate stored struct");
+            return;
+        }
+    }
+}
+
+/* Wait for a flight to land, waking to check the caller's guard if it has one */
+static pxshot_error_t pxshot_flight_wait(pxshot_client_t *client, pxshot_flight_t *flight,
+                                         const pxshot_guard_t *guard) {
+    while (!flight->done) {
+        if (!pxshot_guard_active(guard)) {
+            pthread_cond_wait(&client->flight_landed, &client->flight_lock);
+            continue;
+        }
+        pxshot_error_t stop = pxshot_guard_check(guard);
+        if (stop != PXSHOT_OK) return stop;
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += PXSHOT_GUARD_POLL_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&client->flight_landed, &client->flight_lock, &ts);
+    }
+    return PXSHOT_OK;
+}
+
+/*
+ * Join the capture already in flight for the same options, or start one.
+ * Returns true when resp has been filled in (from the flight, or with the
+ * caller's own cancel/deadline error). Otherwise the caller sends the
+ * request itself and, if *leader is set, lands it for the followers.
+ */
+static bool pxshot_flight_join(pxshot_client_t *client, const char *key, uint64_t hash,
+                               const pxshot_guard_t *guard, pxshot_response_t *resp,
+                               pxshot_flight_t **leader) {
+    pthread_mutex_lock(&client->flight_lock);
+    for (;;) {
+        pxshot_flight_t **slot = pxshot_flight_slot(client, hash, key);
+        pxshot_flight_t *flight = *slot;
+        if (!flight) {
+            flight = (pxshot_flight_t *)pxshot_mem_calloc(client->alloc, 1, sizeof(pxshot_flight_t));
+            if (flight && (flight->key = pxshot_strdup(client->alloc, key))) {
+                flight->hash = hash;
+                flight->refs = 1;
+                *slot = flight;
+                *leader = flight;
+            } else {
+                pxshot_mem_free(client->alloc, flight);
+            }
+            pthread_mutex_unlock(&client->flight_lock);
+            return false;
+        }
+
+        flight->refs++;
+        pxshot_error_t stop = pxshot_flight_wait(client, flight, guard);
+        if (stop != PXSHOT_OK) {
+            pxshot_flight_unref(client, flight);
+            pthread_mutex_unlock(&client->flight_lock);
+            pxshot_set_error(resp, stop, pxshot_guard_message(stop));
+            return true;
+        }
+
+        /* A leader stopped by its own guard has nothing to share; try again */
+        if (!flight->abandoned && flight->result) {
+            pxshot_flight_copy(flight->result, resp);
+            pxshot_flight_unref(client, flight);
+            pthread_mutex_unlock(&client->flight_lock);
+            atomic_fetch_add_explicit(&client->stat_coalesced, 1, memory_order_relaxed);
+            return true;
+        }
+        pxshot_flight_unref(client, flight);
+    }
+}
+
+/* Publish the leader's outcome to its followers */
+static void pxshot_flight_land(pxshot_client_t *client, pxshot_flight_t *flight,
+                               pxshot_response_t *resp) {
+    /* Unlisted first: no new followers can join while the result is built */
+    pthread_mutex_lock(&client->flight_lock);
+    *pxshot_flight_slot(client, flight->hash, flight->key) = flight->next;
+    bool followed = flight->refs > 1;
+    pthread_mutex_unlock(&client->flight_lock);
+
+    pxshot_response_t *result = NULL;
+    bool abandoned = resp->error == PXSHOT_ERR_CANCELLED || resp->error == PXSHOT_ERR_DEADLINE;
+    if (followed && !abandoned && (!resp->data || pxshot_response_share(resp))) {
+        result = pxshot_response_new(client);
+        if (result) pxshot_flight_copy(resp, result);
+    }
+
+    pthread_mutex_lock(&client->flight_lock);
+    flight->result = result;
+    flight->abandoned = abandoned;
+    flight->done = true;
+    pxshot_flight_unref(client, flight);
+    pthread_cond_broadcast(&client->flight_landed);
+    pthread_mutex_unlock(&client->flight_lock);
+}
+
+/* Send a capture, retrying and hedging per the client's policies; image bytes go to sink if set */
+static void pxshot_screenshot_send(pxshot_client_t *client, const pxshot_screenshot_opts_t *opts,
+                                   pxshot_guard_t *guard, const pxshot_sink_t *sink,
+                                   pxshot_response_t *resp) {
+    /* Build JSON body */
+    char body[PXSHOT_BODY_INLINE];
+    char *json_str = pxshot_build_body(client->alloc, opts, body, sizeof(body));
+    if (!json_str) {
+        pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to serialize JSON");
+        return;
+    }
+
+    /* The usage request takes a pooled handle too, so it must not wait behind ours */
+    pxshot_limiter_refresh(client);
+
+    /* Setup CURL */
+    pxshot_conn_t *conn = pxshot_pool_acquire(&client->pool);
+    if (!conn) {
+        if (json_str != body) pxshot_mem_free(client->alloc, json_str);
+        pxshot_set_error(resp, PXSHOT_ERR_CURL_INIT, "failed to create CURL handle");
+        return;
+    }
+    CURL *curl = conn->curl;
+
+    if (client->retry.max_attempts > 1) pxshot_budget_deposit(&client->retry_budget);
+    /* A hedge would write to the sink too */
+    bool hedged = client->hedge.percentile > 0 && !sink;
+    if (hedged) pxshot_budget_deposit(&client->hedge_budget);
+
+    long delay = 0;
+    for (;;) {
+        bool probe;
+        if (pxshot_breaker_admit(client, PXSHOT_API_SCREENSHOT, &probe) != PXSHOT_OK) {
+            pxshot_set_error(resp, PXSHOT_ERR_CIRCUIT_OPEN, "circuit open");
+            break;
+        }
+
+        uint64_t wait_ms;
+        pxshot_error_t limited = pxshot_limiter_reserve(client, guard, false, &wait_ms);
+        if (limited == PXSHOT_OK) limited = pxshot_backoff_sleep(guard, (long)wait_ms);
+        if (limited != PXSHOT_OK) {
+            pxshot_breaker_record(client, PXSHOT_API_SCREENSHOT, probe, PXSHOT_OUTCOME_NEUTRAL);
+            pxshot_set_error(resp, limited, pxshot_limiter_message(client, limited));
+            break;
+        }
+
+        pxshot_buffer_t buffer = { .sink = sink, .curl = curl };
+        pxshot_setup_screenshot(client, conn, json_str, &buffer);
+        pxshot_conn_guard(client, conn, guard);
+
+        pxshot_hedge_t hedge = { .client = client, .body = json_str, .after_ms = -1 };
+        if (hedged) hedge.after_ms = pxshot_latency_threshold(client);
+
+        uint64_t start = (uint64_t)pxshot_clock_ms();
+        CURLcode res = pxshot_conn_perform(conn, guard, &hedge);
+        uint64_t now = (uint64_t)pxshot_clock_ms();
+
+        /* The hedge's transfer and buffer stand in for the original's when it won */
+        CURL *used = curl;
+        if (hedge.won) {
+            pxshot_buffer_free(&buffer);
+            buffer = hedge.buffer;
+            used = hedge.conn->curl;
+            atomic_fetch_add_explicit(&client->stat_hedge_wins, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&client->stat_hedge_saved_ms,
+                                      pxshot_latency_excess(client, now - start), memory_order_relaxed);
+        } else {
+            pxshot_buffer_free(&hedge.buffer);
+        }
+        if (res == CURLE_OK) {
+            pxshot_transport_record(client, used, false);
+            if (hedged) {
+                pxshot_latency_record(client, now - (hedge.won ? hedge.sent_ms : start));
+            }
+        }
+
+        pxshot_screenshot_result(resp, used, res, &buffer, opts->store, guard);
+        if (buffer.sink_failed) {
+            pxshot_response_clear(resp);
+            pxshot_set_error(resp, PXSHOT_ERR_SINK_WRITE, "sink write failed");
+        } else if (sink && resp->error == PXSHOT_OK) {
+            resp->data_len = buffer.streamed;
+        }
+        pxshot_breaker_record(client, PXSHOT_API_SCREENSHOT, probe,
+                              pxshot_breaker_outcome(client, resp, now - start));
+        /* Bytes already in the sink cannot be taken back */
+        bool settled = resp->error == PXSHOT_OK || buffer.streamed > 0;
+        delay = settled ? -1 : pxshot_retry_plan(client, used, resp, guard, delay);
+        pxshot_pool_release(&client->pool, hedge.conn);
+        if (delay < 0) break;
+
+        pxshot_error_t stop = pxshot_backoff_sleep(guard, delay);
+        resp->backoff_ms += (uint64_t)delay;
+        if (stop != PXSHOT_OK) {
+            pxshot_response_clear(resp);
+            pxshot_set_error(resp, stop, pxshot_guard_message(stop));
+            break;
+        }
+        pxshot_response_clear(resp);
+        atomic_fetch_add_explicit(&client->stat_retries, 1, memory_order_relaxed);
+    }
+
+    if (json_str != body) pxshot_mem_free(client->alloc, json_str);
+    pxshot_pool_release(&client->pool, conn);
+}
+
+pxshot_response_t *pxshot_screenshot(pxshot_client_t *client,
+                                      const pxshot_screenshot_opts_t *opts) {
+    pxshot_response_t *resp = pxshot_response_new(client);
+    if (!resp) return NULL;
+
+    if (!client || !opts || !opts->url) {
+        pxshot_set_error(resp, PXSHOT_ERR_INVALID_ARG, "client and opts->url are required");
+        return resp;
+    }
+
+    pxshot_guard_t guard;
+    pxshot_guard_init(&guard, opts);
+    pxshot_error_t stop = pxshot_guard_check(&guard);
+    if (stop != PXSHOT_OK) {
+        pxshot_set_error(resp, stop, pxshot_guard_message(stop));
+        return resp;
+    }
+
+    /* Canonical options key for the cache and coalescing */
+    uint64_t hash = 0;
+    bool cacheable = pxshot_cacheable(client, opts);
+    char *key = cacheable || client->coalesce ? pxshot_opts_key(client->alloc, opts, &hash) : NULL;
+    if (key && cacheable && pxshot_cache_lookup(client, key, hash, opts->store, resp)) {
+        pxshot_mem_free(client->alloc, key);
+        return resp;
+    }
+
+    pxshot_flight_t *flight = NULL;
+    if (!key || !client->coalesce || !pxshot_flight_join(client, key, hash, &guard, resp, &flight)) {
+        pxshot_screenshot_send(client, opts, &guard, NULL, resp);
+        if (key && cacheable) pxshot_cache_store(client, key, hash, resp);
+        if (flight) pxshot_flight_land(client, flight, resp);
+    }
+    pxshot_mem_free(client->alloc, key);
+
+    return resp;
+}
+
+pxshot_response_t *pxshot_screenshot_to_sink(pxshot_client_t *client,
+                                             const pxshot_screenshot_opts_t *opts,
+                                             const pxshot_sink_t *sink) {
+    pxshot_response_t *resp = pxshot_response_new(client);
+    if (!resp) return NULL;
+
+    if (!client || !opts || !opts->url || !sink) {
+        pxshot_set_error(resp, PXSHOT_ERR_INVALID_ARG, "client, opts->url and sink are required");
+        return resp;
+    }
+    if (opts->store) {
+        pxshot_set_error(resp, PXSHOT_ERR_INVALID_ARG, "store=true returns a URL, not image bytes");
+        return resp;
+    }
+    if (sink->type > PXSHOT_SINK_FILE ||
+        (sink->type == PXSHOT_SINK_CALLBACK && !sink->write) ||
+        (sink->type == PXSHOT_SINK_FD && sink->fd < 0) ||
+        (sink->type == PXSHOT_SINK_FILE && !sink->file)) {
+        pxshot_set_error(resp, PXSHOT_ERR_INVALID_ARG, "sink has no destination");
+        return resp;
+    }
+
+    pxshot_guard_t guard;
+    pxshot_guard_init(&guard, opts);
+    pxshot_error_t stop = pxshot_guard_check(&guard);
+    if (stop != PXSHOT_OK) {
+        pxshot_set_error(resp, stop, pxshot_guard_message(stop));
+        return resp;
+    }
+
+    pxshot_screenshot_send(client, opts, &guard, sink, resp);
+    return resp;
+}
+
+pxshot_response_t *pxshot_get_usage(pxshot_client_t *client, pxshot_usage_t **usage) {
+    pxshot_response_t *resp = pxshot_response_new(client);
+    if (!resp) return NULL;
+
+    if (!client || !usage) {
+        pxshot_set_error(resp, PXSHOT_ERR_INVALID_ARG, "client and usage are required");
+        return resp;
+    }
+
+    *usage = NULL;
+
+    bool probe;
+    if (pxshot_breaker_admit(client, PXSHOT_API_USAGE, &probe) != PXSHOT_OK) {
+        pxshot_set_error(resp, PXSHOT_ERR_CIRCUIT_OPEN, "circuit open");
+        return resp;
+    }
+
+    /* Setup CURL */
+    pxshot_conn_t *conn = pxshot_pool_acquire(&client->pool);
+    if (!conn) {
+        pxshot_breaker_record(client, PXSHOT_API_USAGE, probe, PXSHOT_OUTCOME_NEUTRAL);
+        pxshot_set_error(resp, PXSHOT_ERR_CURL_INIT, "failed to create CURL handle");
+        return resp;
+    }
+    CURL *curl = conn->curl;
+
+    pxshot_buffer_t buffer = {0};
+    pxshot_conn_prepare(client, conn, PXSHOT_ENDPOINT_USAGE, &buffer);
+    pxshot_conn_guard(client, conn, NULL);
+
+    uint64_t start = (uint64_t)pxshot_clock_ms();
+    CURLcode res = pxshot_conn_perform(conn, NULL, NULL);
+    if (res == CURLE_OK) pxshot_transport_record(client, curl, false);
+
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    pxshot_pool_release(&client->pool, conn);
+
+    pxshot_response_t outcome = { .retryable = res != CURLE_OK ? pxshot_curl_retryable(res)
+                                                               : pxshot_http_retryable(http_code) };
+    pxshot_breaker_record(client, PXSHOT_API_USAGE, probe,
+                          pxshot_breaker_outcome(client, &outcome, (uint64_t)pxshot_clock_ms() - start));
+
+    if (res != CURLE_OK) {
+        pxshot_buffer_free(&buffer);
+        pxshot_set_error(resp, PXSHOT_ERR_CURL_PERFORM, curl_easy_strerror(res));
+        return resp;
+    }
+
+    resp->http_status = (int)http_code;
+
+    if (http_code >= 400) {
+        pxshot_buffer_free(&buffer);
+        pxshot_set_error(resp, PXSHOT_ERR_HTTP_ERROR, "HTTP error");
+        return resp;
+    }
+
+    /* Parse JSON response */
+    pxshot_reader_t r;
+    pxshot_reader_str_t key, period_start = {0}, period_end = {0};
+    double used = 0, limit = 0, storage_used = 0, storage_limit = 0;
+    pxshot_reader_object(&r, buffer.data, buffer.len);
+    while (pxshot_reader_key(&r, &key)) {
+        if (PXSHOT_KEY_IS(&key, "screenshots_used")) pxshot_reader_get_number(&r, &used);
+        else if (PXSHOT_KEY_IS(&key, "screenshots_limit")) pxshot_reader_get_number(&r, &limit);
+        else if (PXSHOT_KEY_IS(&key, "storage_used_bytes")) pxshot_reader_get_number(&r, &storage_used);
+        else if (PXSHOT_KEY_IS(&key, "storage_limit_bytes")) pxshot_reader_get_number(&r, &storage_limit);
+        else if (PXSHOT_KEY_IS(&key, "period_start")) pxshot_reader_get_string(&r, &period_start);
+        else if (PXSHOT_KEY_IS(&key, "period_end")) pxshot_reader_get_string(&r, &period_end);
+        else pxshot_reader_skip(&r);
+    }
+
+    if (r.failed) {
+        pxshot_buffer_free(&buffer);
+        pxshot_set_error(resp, PXSHOT_ERR_JSON_PARSE, "failed to parse response JSON");
+        return resp;
+    }
+
+    /* One block: the struct, then its strings (decoding never makes them longer) */
+    size_t start_len = period_start.s ? period_start.len + 1 : 0;
+    size_t end_len = period_end.s ? period_end.len + 1 : 0;
+    pxshot_usage_impl_t *impl = (pxshot_usage_impl_t *)pxshot_mem_calloc(
+        client->alloc, 1, sizeof(pxshot_usage_impl_t) + start_len + end_len);
+    if (impl) impl->alloc = client->alloc;
+    *usage = impl ? &impl->pub : NULL;
+    if (!*usage) {
+        pxshot_buffer_free(&buffer);
+        pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to allocate usage struct");
+        return resp;
+    }
+
+    (*usage)->screenshots_used = pxshot_reader_int(used);
+    (*usage)->screenshots_limit = pxshot_reader_int(limit);
+    (*usage)->storage_used_bytes = pxshot_reader_int(storage_used);
+    (*usage)->storage_limit_bytes = pxshot_reader_int(storage_limit);
+    char *text = impl->text;
+    if (period_start.s) {
+        (*usage)->period_start = text;
+        text += pxshot_reader_decode(text, &period_start) + 1;
+    }
+    if (period_end.s) {
+        (*usage)->period_end = text;
+        pxshot_reader_decode(text, &period_end);
+    }
+
+    pxshot_buffer_free(&buffer);
+    pxshot_limiter_calibrate(client, *usage);
+    resp->error = PXSHOT_OK;
+    return resp;
+}
+
+pxshot_error_t pxshot_get_pool_stats(pxshot_client_t *client, pxshot_pool_stats_t *stats) {
+    if (!client || !stats) return PXSHOT_ERR_INVALID_ARG;
+
+    pxshot_pool_t *pool = &client->pool;
+    pthread_mutex_lock(&pool->lock);
+    stats->handles_total = pool->total;
+    stats->handles_idle = pool->idle_count;
+    stats->handles_max = pool->max;
+    stats->checkouts = pool->checkouts;
+    stats->waits = pool->waits;
+    stats->wait_ns_total = pool->wait_ns_total;
+    stats->wait_ns_max = pool->wait_ns_max;
+    pthread_mutex_unlock(&pool->lock);
+    return PXSHOT_OK;
+}
+
+pxshot_error_t pxshot_get_circuit_stats(pxshot_client_t *client, pxshot_api_t api,
+                                        pxshot_circuit_stats_t *stats) {
+    if (!client || !stats || api < PXSHOT_API_SCREENSHOT || api > PXSHOT_API_USAGE) return PXSHOT_ERR_INVALID_ARG;
+
+    pxshot_breaker_t *b = &client->breakers[api];
+    uint64_t now = (uint64_t)pxshot_clock_ms();
+    pthread_mutex_lock(&b->lock);
+    pxshot_breaker_refresh_locked(client, b, now);
+    stats->state = b->state;
+    pxshot_breaker_window_locked(client, b, now, &stats->window_requests, &stats->window_failures);
+    stats->rejected = b->rejected;
+    stats->opened = b->opened;
+    pthread_mutex_unlock(&b->lock);
+    return PXSHOT_OK;
+}
+
+pxshot_error_t pxshot_get_cache_stats(pxshot_client_t *client, pxshot_cache_stats_t *stats) {
+    if (!client || !stats) return PXSHOT_ERR_INVALID_ARG;
+
+    stats->hits = atomic_load_explicit(&client->stat_cache_hits, memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&client->stat_cache_misses, memory_order_relaxed);
+    stats->evictions = atomic_load_explicit(&client->stat_cache_evictions, memory_order_relaxed);
+    stats->expirations = atomic_load_explicit(&client->stat_cache_expirations, memory_order_relaxed);
+    stats->stored_hits = atomic_load_explicit(&client->stat_stored_hits, memory_order_relaxed);
+    pthread_mutex_lock(&client->stored_lock);
+    stats->stored_entries = client->stored_count;
+    pthread_mutex_unlock(&client->stored_lock);
+    stats->entries = 0;
+    stats->bytes = 0;
+    for (int i = 0; client->cache_shards && i < client->cache.shards; i++) {
+        pxshot_cache_shard_t *shard = &client->cache_shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->entries += shard->entries;
+        stats->bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return PXSHOT_OK;
+}
+
+pxshot_error_t pxshot_get_disk_cache_stats(pxshot_client_t *client, pxshot_disk_cache_stats_t *stats) {
+    if (!client || !stats) return PXSHOT_ERR_INVALID_ARG;
+
+    stats->hits = atomic_load_explicit(&client->stat_disk_hits, memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&client->stat_disk_misses, memory_order_relaxed);
+    stats->evictions = atomic_load_explicit(&client->stat_disk_evictions, memory_order_relaxed);
+    stats->expirations = atomic_load_explicit(&client->stat_disk_expirations, memory_order_relaxed);
+    stats->entries = 0;
+    stats->files = 0;
+    stats->bytes = 0;
+    if (client->disk) {
+        pthread_mutex_lock(&client->disk->lock);
+        stats->entries = client->disk->entry_count;
+        stats->files = client->disk->object_count;
+        stats->bytes = client->disk->bytes;
+        pthread_mutex_unlock(&client->disk->lock);
+    }
+    return PXSHOT_OK;
+}
+
+pxshot_error_t pxshot_get_buffer_pool_stats(pxshot_client_t *client, pxshot_buffer_pool_stats_t *stats) {
+    if (!client || !stats) return PXSHOT_ERR_INVALID_ARG;
+
+    memset(stats, 0, sizeof(*stats));
+    pxshot_bufpool_t *pool = client->bufpool;
+    if (!pool) return PXSHOT_OK;
+    stats->hits = atomic_load_explicit(&pool->hits, memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&pool->misses, memory_order_relaxed);
+    stats->recycled = atomic_load_explicit(&pool->recycled, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&pool->dropped, memory_order_relaxed);
+    stats->idle_bytes = atomic_load_explicit(&pool->idle_bytes, memory_order_relaxed);
+    for (int i = 0; i < PXSHOT_BUFPOOL_CLASSES; i++) {
+        pthread_mutex_lock(&pool->classes[i].lock);
+        stats->idle_buffers += pool->classes[i].count;
+        pthread_mutex_unlock(&pool->classes[i].lock);
+    }
+    return PXSHOT_OK;
+}
+
+pxshot_error_t pxshot_get_concurrency_stats(pxshot_client_t *client, pxshot_concurrency_stats_t *stats) {
+    if (!client || !stats) return PXSHOT_ERR_INVALID_ARG;
+
+    stats->limit = client->concurrency.adaptive ? (int)client->climit.limit : 0;
+    stats->active = client->inflight_count - client->deferred_count;
+    stats->waiting = client->deferred_count;
+    stats->rtt_ms = client->climit.rtt_short;
+    stats->rtt_baseline_ms = client->climit.rtt_long;
+    stats->backoffs = client->climit.backoffs;
+    return PXSHOT_OK;
+}
+
+pxshot_error_t pxshot_get_rate_limit_stats(pxshot_client_t *client, pxshot_rate_limit_stats_t *stats) {
+    if (!client || !stats) return PXSHOT_ERR_INVALID_ARG;
+
+    pxshot_limiter_t *l = &client->limiter;
+    int64_t interval = atomic_load(&l->interval_ns);
+    stats->requests_per_sec = interval > 0 ? 1e9 / (double)interval : 0;
+    stats->quota_exhausted = atomic_load(&l->exhausted);
+    stats->delayed = atomic_load_explicit(&l->delayed, memory_order_relaxed);
+    stats->delay_ms = atomic_load_explicit(&l->delay_ms, memory_order_relaxed);
+    stats->rejected = atomic_load_explicit(&l->rejected, memory_order_relaxed);
+    return PXSHOT_OK;
+}
+
+pxshot_error_t pxshot_get_transport_stats(pxshot_client_t *client, pxshot_transport_stats_t *stats) {
+    if (!client || !stats) return PXSHOT_ERR_INVALID_ARG;
+
+    stats->requests = atomic_load_explicit(&client->stat_requests, memory_order_relaxed);
+    stats->connections = atomic_load_explicit(&client->stat_connections, memory_order_relaxed);
+    stats->http2_streams = atomic_load_explicit(&client->stat_http2_streams, memory_order_relaxed);
+    stats->http2_multiplexed = atomic_load_explicit(&client->stat_http2_multiplexed, memory_order_relaxed);
+    stats->retries = atomic_load_explicit(&client->stat_retries, memory_order_relaxed);
+    stats->retries_throttled = atomic_load_explicit(&client->stat_retries_throttled, memory_order_relaxed);
+    stats->hedges = atomic_load_explicit(&client->stat_hedges, memory_order_relaxed);
+    stats->hedges_throttled = atomic_load_explicit(&client->stat_hedges_throttled, memory_order_relaxed);
+    stats->hedge_wins = atomic_load_explicit(&client->stat_hedge_wins, memory_order_relaxed);
+    stats->hedge_saved_ms = atomic_load_explicit(&client->stat_hedge_saved_ms, memory_order_relaxed);
+    stats->coalesced = atomic_load_explicit(&client->stat_coalesced, memory_order_relaxed);
+    return PXSHOT_OK;
+}
+
+/* Asynchronous engine */
+
+static void pxshot_list_unlink(pxshot_request_t **head, pxshot_request_t **tail,
+                               pxshot_request_t *req) {
+    if (req->prev) req->prev->next = req->next;
+    else *head = req->next;
+    if (req->next) req->next->prev = req->prev;
+    else if (tail) *tail = req->prev;
+    req->prev = req->next = NULL;
+}
+
+/* Queue a completed request; callbacks run on the next dispatch */
+static void pxshot_request_complete(pxshot_request_t *req) {
+    pxshot_client_t *client = req->client;
+    pxshot_request_t **head = req->on_complete ? &client->cb_head : &client->done_head;
+    pxshot_request_t **tail = req->on_complete ? &client->cb_tail : &client->done_tail;
+    req->done = true;
+    req->prev = *tail;
+    req->next = NULL;
+    if (*tail) (*tail)->next = req;
+    else *head = req;
+    *tail = req;
+    client->done_count++;
+}
+
+/* Detach the transfer from the multi handle and free per-transfer resources */
+static void pxshot_request_detach(pxshot_request_t *req) {
+    if (req->deferred) {
+        req->client->deferred_count--;
+        req->deferred = false;
+    }
+    if (req->admitted) {
+        /* Abandoned before completing: release a probe slot without a verdict */
+        pxshot_breaker_record(req->client, PXSHOT_API_SCREENSHOT, req->probe, PXSHOT_OUTCOME_NEUTRAL);
+        req->admitted = false;
+    }
+    if (req->guarded) {
+        req->client->guarded_inflight--;
+        req->guarded = false;
+    }
+    if (req->conn) {
+        /* Handles are only attached while the request is linked to its client */
+        curl_multi_remove_handle(req->client->multi, req->conn->curl);
+        pxshot_pool_release(&req->client->pool, req->conn);
+        req->conn = NULL;
+    }
+    if (req->body != req->body_inline) pxshot_mem_free(req->alloc, req->body);
+    req->body = NULL;
+}
+
+static void pxshot_request_release(pxshot_request_t *req) {
+    const pxshot_allocator_t *alloc = req->alloc;
+    pxshot_request_detach(req);
+    pxshot_mem_free(alloc, req->cache_key);
+    pxshot_buffer_free(&req->buffer);
+    pxshot_response_free(req->response);
+    pxshot_mem_free(alloc, req);
+}
+
+/* Local and remote port of the connection a transfer is on; 0 until it has one */
+static uint32_t pxshot_conn_ports(CURL *curl) {
+    long local = 0, remote = 0;
+    curl_easy_getinfo(curl, CURLINFO_LOCAL_PORT, &local);
+    curl_easy_getinfo(curl, CURLINFO_PRIMARY_PORT, &remote);
+    return local > 0 && remote > 0 ? ((uint32_t)local << 16) | (uint32_t)remote : 0;
+}
+
+/*
+ * Mark a finished HTTP/2 transfer, and every transfer still running on the
+ * same connection, as multiplexed. The later ones are counted when they
+ * finish, so a pair of overlapping streams counts twice whichever ends first.
+ */
+static void pxshot_async_note_streams(pxshot_client_t *client, pxshot_request_t *req) {
+    long version = 0;
+    curl_easy_getinfo(req->conn->curl, CURLINFO_HTTP_VERSION, &version);
+    uint32_t ports = version == CURL_HTTP_VERSION_2_0 ? pxshot_conn_ports(req->conn->curl) : 0;
+    if (!ports) return;
+    for (pxshot_request_t *other = client->inflight; other; other = other->next) {
+        if (other == req || !other->conn || other->deferred) continue;
+        if (pxshot_conn_ports(other->conn->curl) == ports) {
+            other->multiplexed = true;
+            req->multiplexed = true;
+        }
+    }
+}
+
+/* Build the response of a finished in-flight request and queue its completion */
+static void pxshot_async_finish(pxshot_client_t *client, pxshot_request_t *req, CURLcode res) {
+    if (res == CURLE_OK) {
+        pxshot_async_note_streams(client, req);
+        pxshot_transport_record(client, req->conn->curl, req->multiplexed);
+    }
+    pxshot_screenshot_result(req->response, req->conn->curl, res,
+                             &req->buffer, req->store, &req->guard);
+    uint64_t elapsed = (uint64_t)pxshot_clock_ms() - req->start_ms;
+    pxshot_breaker_record(client, PXSHOT_API_SCREENSHOT, req->probe,
+                          pxshot_breaker_outcome(client, req->response, elapsed));
+    pxshot_climit_sample(client, req->response, (double)elapsed,
+                         client->inflight_count - client->deferred_count);
+    req->admitted = false;
+    if (req->cache_key) pxshot_cache_store(client, req->cache_key, req->cache_hash, req->response);
+    req->buffer.data = NULL;
+    req->buffer.len = req->buffer.cap = 0;
+
+    pxshot_list_unlink(&client->inflight, &client->inflight_tail, req);
+    client->inflight_count--;
+    pxshot_request_detach(req);
+    pxshot_request_complete(req);
+}
+
+/* Complete an in-flight request that has no transfer attached */
+static void pxshot_async_abandon(pxshot_client_t *client, pxshot_request_t *req,
+                                 pxshot_error_t err, const char *msg);
+
+/* Collect finished transfers from the multi handle */
+static void pxshot_async_collect(pxshot_client_t *client) {
+    CURLMsg *msg;
+    int queued;
+    while ((msg = curl_multi_info_read(client->multi, &queued))) {
+        if (msg->msg != CURLMSG_DONE) continue;
+
+        pxshot_request_t *req = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&req);
+        if (!req) continue;
+
+        pxshot_async_finish(client, req, msg->data.result);
+    }
+}
+
+/* Abort in-flight requests whose token fired or deadline passed */
+static void pxshot_async_check_guards(pxshot_client_t *client) {
+    if (client->guarded_inflight == 0) return;
+
+    pxshot_request_t *req = client->inflight;
+    while (req) {
+        pxshot_request_t *next = req->next;
+        if (req->guarded && (req->guard.reason = pxshot_guard_check(&req->guard)) != PXSHOT_OK) {
+            if (req->conn) {
+                pxshot_async_finish(client, req, CURLE_ABORTED_BY_CALLBACK);
+            } else {
+                pxshot_async_abandon(client, req, req->guard.reason, pxshot_guard_message(req->guard.reason));
+            }
+        }
+        req = next;
+    }
+}
+
+/* Whether the concurrency limit allows another transfer to start */
+static bool pxshot_async_has_slot(const pxshot_client_t *client) {
+    if (!client->concurrency.adaptive) return true;
+    return (double)(client->inflight_count - client->deferred_count) < (int)client->climit.limit;
+}
+
+/*
+ * Milliseconds until the next deferred request is due, or -1 if none.
+ * Requests held only by the concurrency limit wait for a completion instead.
+ */
+static long pxshot_async_next_start(const pxshot_client_t *client) {
+    if (client->deferred_count == 0) return -1;
+
+    uint64_t now = (uint64_t)pxshot_clock_ms();
+    bool slot = pxshot_async_has_slot(client);
+    long next = -1;
+    for (const pxshot_request_t *req = client->inflight; req; req = req->next) {
+        if (!req->deferred || (req->start_at_ms <= now && !slot)) continue;
+        long left = req->start_at_ms > now ? (long)(req->start_at_ms - now) : 0;
+        if (next < 0 || left < next) next = left;
+    }
+    return next;
+}
+
+/* Cap a multi wait so guarded requests are checked and deferred ones started on time */
+static int pxshot_async_wait_ms(const pxshot_client_t *client, int timeout_ms) {
+    if (client->guarded_inflight > 0 && timeout_ms > PXSHOT_GUARD_POLL_MS) timeout_ms = PXSHOT_GUARD_POLL_MS;
+    long start = pxshot_async_next_start(client);
+    if (start >= 0 && start < timeout_ms) timeout_ms = (int)start;
+    return timeout_ms;
+}
+
+/* Run the callbacks of completed callback-style requests */
+static void pxshot_async_dispatch(pxshot_client_t *client) {
+    while (client->cb_head) {
+        pxshot_request_t *req = client->cb_head;
+        pxshot_list_unlink(&client->cb_head, &client->cb_tail, req);
+        client->done_count--;
+        pxshot_response_t *resp = req->response;
+        req->response = NULL;
+        req->on_complete(req, resp, req->userdata);
+        pxshot_request_release(req);
+    }
+}
+
+/* Wake the external loop so completions queued outside it get dispatched */
+static void pxshot_loop_kick(pxshot_client_t *client) {
+    if (!client->loop_timer || !client->cb_head) return;
+    client->loop_kicked = true;
+    client->loop_timer(0, client->loop_userdata);
+}
+
+/* Queue an immediate completion from pxshot_submit() */
+static void pxshot_submit_complete(pxshot_request_t *req) {
+    pxshot_request_complete(req);
+    pxshot_loop_kick(req->client);
+}
+
+static void pxshot_async_abandon(pxshot_client_t *client, pxshot_request_t *req,
+                                 pxshot_error_t err, const char *msg) {
+    pxshot_list_unlink(&client->inflight, &client->inflight_tail, req);
+    client->inflight_count--;
+    pxshot_request_detach(req);
+    pxshot_set_error(req->response, err, msg);
+    pxshot_submit_complete(req);
+}
+
+/* Attach the transfer of a linked in-flight request to the multi handle */
+static void pxshot_async_start(pxshot_client_t *client, pxshot_request_t *req) {
+    if (req->deferred) {
+        client->deferred_count--;
+        req->deferred = false;
+    }
+    req->start_ms = (uint64_t)pxshot_clock_ms();
+
+    pxshot_conn_t *conn = pxshot_pool_try_acquire(&client->pool);
+    if (!conn) {
+        pxshot_async_abandon(client, req, PXSHOT_ERR_CURL_INIT, "failed to create CURL handle");
+        return;
+    }
+
+    pxshot_setup_screenshot(client, conn, req->body, &req->buffer);
+    pxshot_conn_guard(client, conn, &req->guard);
+    curl_easy_setopt(conn->curl, CURLOPT_PRIVATE, (char *)req);
+
+    if (curl_multi_add_handle(client->multi, conn->curl) != CURLM_OK) {
+        pxshot_pool_release(&client->pool, conn);
+        pxshot_async_abandon(client, req, PXSHOT_ERR_CURL_INIT, "failed to add transfer");
+        return;
+    }
+    req->conn = conn;
+}
+
+/* Start deferred requests that are due, oldest first, while slots are free */
+static void pxshot_async_start_due(pxshot_client_t *client) {
+    if (client->deferred_count == 0) return;
+
+    uint64_t now = (uint64_t)pxshot_clock_ms();
+    pxshot_request_t *req = client->inflight;
+    while (req && pxshot_async_has_slot(client)) {
+        pxshot_request_t *next = req->next;
+        if (req->deferred && req->start_at_ms <= now) pxshot_async_start(client, req);
+        req = next;
+    }
+}
+
+/* Loop timer deadline: curl's, capped while guards need checking, or sooner if a deferred request is due */
+static long pxshot_loop_timeout(const pxshot_client_t *client, long timeout_ms) {
+    if (client->guarded_inflight > 0 && (timeout_ms < 0 || timeout_ms > PXSHOT_GUARD_POLL_MS)) {
+        timeout_ms = PXSHOT_GUARD_POLL_MS;
+    }
+    long start = pxshot_async_next_start(client);
+    if (start >= 0 && (timeout_ms < 0 || start < timeout_ms)) return start;
+    return timeout_ms;
+}
+
+/* Re-arm the external loop's timer; a pending kick re-arms it itself */
+static void pxshot_loop_rearm(pxshot_client_t *client) {
+    if (!client->loop_timer || client->loop_kicked) return;
+    long timeout_ms = -1;
+    curl_multi_timeout(client->multi, &timeout_ms);
+    client->loop_timer(pxshot_loop_timeout(client, timeout_ms), client->loop_userdata);
+}
+
+/* Run transfers once and collect anything that finished */
+static bool pxshot_async_perform(pxshot_client_t *client) {
+    pxshot_async_start_due(client);
+    int running = 0;
+    if (curl_multi_perform(client->multi, &running) != CURLM_OK) return false;
+    pxshot_async_collect(client);
+    pxshot_async_check_guards(client);
+    pxshot_async_start_due(client);
+    return true;
+}
+
+static void pxshot_async_abort_all(pxshot_client_t *client) {
+    pxshot_request_t **queues[] = { &client->inflight, &client->cb_head, &client->done_head };
+    for (size_t i = 0; i < sizeof(queues) / sizeof(queues[0]); i++) {
+        while (*queues[i]) {
+            pxshot_request_t *req = *queues[i];
+            *queues[i] = req->next;
+            pxshot_request_release(req);
+        }
+    }
+    client->inflight_tail = client->cb_tail = client->done_tail = NULL;
+    client->inflight_count = client->done_count = 0;
+}
+
+pxshot_request_t *pxshot_submit(pxshot_client_t *client,
+                                const pxshot_screenshot_opts_t *opts,
+                                pxshot_request_cb on_complete,
+                                void *userdata) {
+    if (!client) return NULL;
+
+    pxshot_request_t *req = (pxshot_request_t *)pxshot_mem_calloc(client->alloc, 1, sizeof(pxshot_request_t));
+    if (!req) return NULL;
+    req->client = client;
+    req->alloc = client->alloc;
+    req->on_complete = on_complete;
+    req->userdata = userdata;
+    req->response = pxshot_response_new(client);
+    if (!req->response) {
+        pxshot_mem_free(client->alloc, req);
+        return NULL;
+    }
+
+    if (!opts || !opts->url) {
+        pxshot_set_error(req->response, PXSHOT_ERR_INVALID_ARG, "client and opts->url are required");
+        pxshot_submit_complete(req);
+        return req;
+    }
+    req->store = opts->store;
+
+    if (pxshot_cacheable(client, opts)) {
+        req->cache_key = pxshot_opts_key(client->alloc, opts, &req->cache_hash);
+        if (req->cache_key &&
+            pxshot_cache_lookup(client, req->cache_key, req->cache_hash, opts->store, req->response)) {
+            pxshot_submit_complete(req);
+            return req;
+        }
+    }
+
+    pxshot_guard_init(&req->guard, opts);
+    pxshot_error_t stop = pxshot_guard_check(&req->guard);
+    if (stop != PXSHOT_OK) {
+        pxshot_set_error(req->response, stop, pxshot_guard_message(stop));
+        pxshot_submit_complete(req);
+        return req;
+    }
+
+    if (pxshot_breaker_admit(client, PXSHOT_API_SCREENSHOT, &req->probe) != PXSHOT_OK) {
+        pxshot_set_error(req->response, PXSHOT_ERR_CIRCUIT_OPEN, "circuit open");
+        pxshot_submit_complete(req);
+        return req;
+    }
+    req->admitted = true;
+
+    /* Without a token now, the request waits in the in-flight list until it is due */
+    uint64_t wait_ms;
+    pxshot_error_t limited = pxshot_limiter_reserve(client, &req->guard, false, &wait_ms);
+    if (limited != PXSHOT_OK) {
+        pxshot_request_detach(req);
+        pxshot_set_error(req->response, limited, pxshot_limiter_message(client, limited));
+        pxshot_submit_complete(req);
+        return req;
+    }
+
+    req->body = pxshot_build_body(client->alloc, opts, req->body_inline, sizeof(req->body_inline));
+    if (!req->body) {
+        pxshot_request_detach(req);
+        pxshot_set_error(req->response, PXSHOT_ERR_OUT_OF_MEMORY, "failed to serialize JSON");
+        pxshot_submit_complete(req);
+        return req;
+    }
+
+    if (pxshot_guard_active(&req->guard)) {
+        req->guarded = true;
+        client->guarded_inflight++;
+    }
+    req->prev = client->inflight_tail;
+    if (client->inflight_tail) client->inflight_tail->next = req;
+    else client->inflight = req;
+    client->inflight_tail = req;
+    client->inflight_count++;
+
+    if (wait_ms > 0 || !pxshot_async_has_slot(client)) {
+        req->deferred = true;
+        req->start_at_ms = (uint64_t)pxshot_clock_ms() + wait_ms;
+        client->deferred_count++;
+        pxshot_loop_rearm(client);
+    } else {
+        pxshot_async_start(client, req);
+    }
+    return req;
+}
+
+int pxshot_poll(pxshot_client_t *client, int timeout_ms) {
+    if (!client) return -1;
 
-pxshot_client_t *pxshot_new(const char *api_key) {
-    pxshot_config_t config = {
-        .api_key = api_key,
-        .base_url = NULL,
-        .timeout_ms = 0
-    };
-    return pxshot_new_with_config(&config);
+    /* An attached event loop drives the transfers */
+    if (client->inflight_count > 0 && !client->loop_socket) {
+        if (!pxshot_async_perform(client)) return -1;
+        if (client->inflight_count > 0 && timeout_ms > 0 &&
+            !client->cb_head && !client->done_head) {
+            int wait_ms = pxshot_async_wait_ms(client, timeout_ms);
+            if (curl_multi_poll(client->multi, NULL, 0, wait_ms, NULL) != CURLM_OK) return -1;
+            if (!pxshot_async_perform(client)) return -1;
+        }
+    }
+
+    pxshot_async_dispatch(client);
+    return (int)client->inflight_count;
 }
 
-pxshot_client_t *pxshot_new_with_config(const pxshot_config_t *config) {
-    if (!config || !config->api_key) return NULL;
-    
-    pxshot_client_t *client = (pxshot_client_t *)calloc(1, sizeof(pxshot_client_t));
+pxshot_request_t *pxshot_wait_any(pxshot_client_t *client, int timeout_ms) {
     if (!client) return NULL;
-    
-    client->api_key = pxshot_strdup(config->api_key);
-    client->base_url = pxshot_strdup(config->base_url ? config->base_url : PXSHOT_DEFAULT_BASE_URL);
-    client->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 30000;
-    
-    if (!client->api_key || !client->base_url) {
-        pxshot_free(client);
-        return NULL;
-    }
-    
-    client->curl = curl_easy_init();
-    if (!client->curl) {
-        pxshot_free(client);
-        return NULL;
+
+    int64_t deadline = timeout_ms >= 0 ? pxshot_clock_ms() + timeout_ms : -1;
+    for (;;) {
+        pxshot_async_dispatch(client);
+        pxshot_request_t *req = client->done_head;
+        if (req) {
+            pxshot_list_unlink(&client->done_head, &client->done_tail, req);
+            client->done_count--;
+            req->client = NULL;
+            return req;
+        }
+        if (client->inflight_count == 0 || client->loop_socket) return NULL;
+
+        int wait_ms = 1000;
+        if (deadline >= 0) {
+            int64_t left = deadline - pxshot_clock_ms();
+            if (left <= 0) return NULL;
+            if (left < wait_ms) wait_ms = (int)left;
+        }
+
+        if (!pxshot_async_perform(client)) return NULL;
+        if (client->cb_head || client->done_head) continue;
+        wait_ms = pxshot_async_wait_ms(client, wait_ms);
+        if (curl_multi_poll(client->multi, NULL, 0, wait_ms, NULL) != CURLM_OK) return NULL;
+        if (!pxshot_async_perform(client)) return NULL;
     }
-    
-    return client;
 }
 
-void pxshot_free(pxshot_client_t *client) {
-    if (!client) return;
-    if (client->curl) curl_easy_cleanup(client->curl);
-    free(client->api_key);
-    free(client->base_url);
-    free(client);
+bool pxshot_request_is_done(const pxshot_request_t *req) {
+    return req && req->done;
 }
 
-pxshot_response_t *pxshot_screenshot(pxshot_client_t *client,
-                                      const pxshot_screenshot_opts_t *opts) {
-    pxshot_response_t *resp = pxshot_response_new();
-    if (!resp) return NULL;
-    
-    if (!client || !opts || !opts->url) {
-        pxshot_set_error(resp, PXSHOT_ERR_INVALID_ARG, "client and opts->url are required");
-        return resp;
+void *pxshot_request_userdata(const pxshot_request_t *req) {
+    return req ? req->userdata : NULL;
+}
+
+pxshot_response_t *pxshot_request_finish(pxshot_request_t *req) {
+    if (!req) return NULL;
+
+    /* Futures returned by pxshot_wait_any() are already unlinked */
+    pxshot_client_t *client = req->client;
+    if (client) {
+        if (req->done) {
+            pxshot_list_unlink(&client->done_head, &client->done_tail, req);
+            client->done_count--;
+        } else {
+            pxshot_list_unlink(&client->inflight, &client->inflight_tail, req);
+            client->inflight_count--;
+        }
     }
-    
-    /* Build JSON body */
-    cJSON *body = cJSON_CreateObject();
-    if (!body) {
-        pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to create JSON");
-        return resp;
+
+    pxshot_response_t *resp = NULL;
+    if (req->done) {
+        resp = req->response;
+        req->response = NULL;
     }
-    
-    cJSON_AddStringToObject(body, "url", opts->url);
-    cJSON_AddStringToObject(body, "format", pxshot_format_string(opts->format));
-    
-    if (opts->quality > 0)
-        cJSON_AddNumberToObject(body, "quality", opts->quality);
-    if (opts->width > 0)
-        cJSON_AddNumberToObject(body, "width", opts->width);
-    if (opts->height > 0)
-        cJSON_AddNumberToObject(body, "height", opts->height);
-    if (opts->full_page)
-        cJSON_AddBoolToObject(body, "full_page", true);
-    if (opts->wait_until != PXSHOT_WAIT_LOAD)
-        cJSON_AddStringToObject(body, "wait_until", pxshot_wait_until_string(opts->wait_until));
-    if (opts->wait_for_selector)
-        cJSON_AddStringToObject(body, "wait_for_selector", opts->wait_for_selector);
-    if (opts->wait_for_timeout > 0)
-        cJSON_AddNumberToObject(body, "wait_for_timeout", opts->wait_for_timeout);
-    if (opts->device_scale_factor > 0)
-        cJSON_AddNumberToObject(body, "device_scale_factor", opts->device_scale_factor);
-    if (opts->store)
-        cJSON_AddBoolToObject(body, "store", true);
-    
-    char *json_str = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
-    
-    if (!json_str) {
-        pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to serialize JSON");
-        return resp;
+    pxshot_request_release(req);
+    return resp;
+}
+
+size_t pxshot_pending(const pxshot_client_t *client) {
+    return client ? client->inflight_count + client->done_count : 0;
+}
+
+/* Abort every queued or in-flight request that would call cb with userdata */
+static void pxshot_async_abort_matching(pxshot_client_t *client, pxshot_request_cb cb,
+                                        void *userdata) {
+    pxshot_request_t *req = client->inflight;
+    while (req) {
+        pxshot_request_t *next = req->next;
+        if (req->on_complete == cb && req->userdata == userdata) {
+            pxshot_list_unlink(&client->inflight, &client->inflight_tail, req);
+            client->inflight_count--;
+            pxshot_request_release(req);
+        }
+        req = next;
     }
-    
-    /* Build URL */
-    size_t url_len = strlen(client->base_url) + 32;
-    char *url = (char *)malloc(url_len);
-    if (!url) {
-        free(json_str);
-        pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to allocate URL");
-        return resp;
+    req = client->cb_head;
+    while (req) {
+        pxshot_request_t *next = req->next;
+        if (req->on_complete == cb && req->userdata == userdata) {
+            pxshot_list_unlink(&client->cb_head, &client->cb_tail, req);
+            client->done_count--;
+            pxshot_request_release(req);
+        }
+        req = next;
     }
-    snprintf(url, url_len, "%s/v1/screenshot", client->base_url);
-    
-    /* Build auth header */
-    size_t auth_len = strlen(client->api_key) + 32;
-    char *auth_header = (char *)malloc(auth_len);
-    if (!auth_header) {
-        free(json_str);
-        free(url);
-        pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to allocate header");
-        return resp;
+}
+
+/* Batch capture */
+
+typedef struct {
+    pxshot_client_t *client;
+    const pxshot_screenshot_opts_t *opts;
+    size_t count;
+    size_t next;                    /* Next item to submit */
+    size_t inflight;
+    pxshot_batch_cb on_item;
+    void *userdata;
+    pxshot_response_t **results;
+    pxshot_error_t error;
+} pxshot_batch_t;
+
+static void pxshot_batch_on_complete(pxshot_request_t *req, pxshot_response_t *resp, void *userdata);
+
+static void pxshot_batch_submit_next(pxshot_batch_t *batch) {
+    if (batch->error != PXSHOT_OK || batch->next >= batch->count) return;
+
+    size_t index = batch->next++;
+    pxshot_request_t *req = pxshot_submit(batch->client, &batch->opts[index],
+                                          pxshot_batch_on_complete, batch);
+    if (!req) {
+        batch->error = PXSHOT_ERR_OUT_OF_MEMORY;
+        return;
     }
-    snprintf(auth_header, auth_len, "Authorization: Bearer %s", client->api_key);
-    
-    /* Setup CURL */
-    CURL *curl = client->curl;
-    curl_easy_reset(curl);
-    
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    
-    pxshot_buffer_t buffer = {0};
-    
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_str);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, pxshot_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, client->timeout_ms);
-    
-    CURLcode res = curl_easy_perform(curl);
-    
-    curl_slist_free_all(headers);
-    free(auth_header);
-    free(url);
-    free(json_str);
-    
-    if (res != CURLE_OK) {
-        free(buffer.data);
-        if (res == CURLE_OPERATION_TIMEDOUT) {
-            pxshot_set_error(resp, PXSHOT_ERR_TIMEOUT, curl_easy_strerror(res));
-        } else {
-            pxshot_set_error(resp, PXSHOT_ERR_CURL_PERFORM, curl_easy_strerror(res));
-        }
-        return resp;
+    req->index = index;
+    batch->inflight++;
+}
+
+static void pxshot_batch_on_complete(pxshot_request_t *req, pxshot_response_t *resp, void *userdata) {
+    pxshot_batch_t *batch = (pxshot_batch_t *)userdata;
+    batch->inflight--;
+    if (batch->on_item) {
+        batch->on_item(req->index, resp, batch->userdata);
+    } else {
+        batch->results[req->index] = resp;
     }
-    
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    resp->http_status = (int)http_code;
-    
-    if (http_code >= 400) {
-        /* Try to parse error message from JSON */
-        cJSON *err_json = cJSON_Parse((char *)buffer.data);
-        if (err_json) {
-            cJSON *msg = cJSON_GetObjectItem(err_json, "error");
-            if (msg && cJSON_IsString(msg)) {
-                resp->error_message = pxshot_strdup(msg->valuestring);
-            }
-            cJSON_Delete(err_json);
+    pxshot_batch_submit_next(batch);
+}
+
+pxshot_error_t pxshot_screenshot_batch(pxshot_client_t *client,
+                                       const pxshot_screenshot_opts_t *opts,
+                                       size_t count,
+                                       size_t concurrency,
+                                       pxshot_batch_cb on_item,
+                                       void *userdata,
+                                       pxshot_response_t **results) {
+    if (!client || (!opts && count > 0) || (!on_item && !results)) return PXSHOT_ERR_INVALID_ARG;
+    if (client->loop_socket) return PXSHOT_ERR_INVALID_ARG;
+    if (count > SIZE_MAX / sizeof(*results)) return PXSHOT_ERR_INVALID_ARG;
+    if (!on_item) memset(results, 0, count * sizeof(*results));
+    if (concurrency == 0) concurrency = client->concurrency.adaptive ? (size_t)client->concurrency.max_limit : 16;
+
+    pxshot_batch_t batch = {
+        .client = client,
+        .opts = opts,
+        .count = count,
+        .on_item = on_item,
+        .userdata = userdata,
+        .results = results,
+        .error = PXSHOT_OK
+    };
+
+    while (batch.inflight < concurrency && batch.next < count && batch.error == PXSHOT_OK) {
+        pxshot_batch_submit_next(&batch);
+    }
+
+    while (batch.inflight > 0) {
+        if (pxshot_poll(client, 1000) < 0) {
+            /* The batch state lives on this stack frame; drop its requests */
+            pxshot_async_abort_matching(client, pxshot_batch_on_complete, &batch);
+            batch.error = PXSHOT_ERR_CURL_PERFORM;
+            break;
         }
-        free(buffer.data);
-        pxshot_set_error(resp, PXSHOT_ERR_HTTP_ERROR, 
-                         resp->error_message ? resp->error_message : "HTTP error");
-        return resp;
     }
-    
-    /* Check if response is JSON (stored) or binary (image) */
-    char *content_type = NULL;
-    curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &content_type);
-    
-    if (opts->store || (content_type && strstr(content_type, "application/json"))) {
-        /* Parse stored response */
-        cJSON *json = cJSON_Parse((char *)buffer.data);
-        free(buffer.data);
-        
-        if (!json) {
-            pxshot_set_error(resp, PXSHOT_ERR_JSON_PARSE, "failed to parse response JSON");
-            return resp;
-        }
-        
-        resp->stored = (pxshot_stored_t *)calloc(1, sizeof(pxshot_stored_t));
-        if (!resp->stored) {
-            cJSON_Delete(json);
-            pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to allocate stored struct");
-            return resp;
-        }
-        
-        cJSON *item;
-        if ((item = cJSON_GetObjectItem(json, "url")) && cJSON_IsString(item))
-            resp->stored->url = pxshot_strdup(item->valuestring);
-        if ((item = cJSON_GetObjectItem(json, "expires_at")) && cJSON_IsString(item))
-            resp->stored->expires_at = pxshot_strdup(item->valuestring);
-        if ((item = cJSON_GetObjectItem(json, "width")) && cJSON_IsNumber(item))
-            resp->stored->width = item->valueint;
-        if ((item = cJSON_GetObjectItem(json, "height")) && cJSON_IsNumber(item))
-            resp->stored->height = item->valueint;
-        if ((item = cJSON_GetObjectItem(json, "size_bytes")) && cJSON_IsNumber(item))
-            resp->stored->size_bytes = (size_t)item->valuedouble;
-        
-        cJSON_Delete(json);
+
+    return batch.error;
+}
+
+/* Event loop integration */
+
+static int pxshot_loop_socket_cb(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp) {
+    (void)easy;
+    (void)socketp;
+    pxshot_client_t *client = (pxshot_client_t *)userp;
+    int events = 0;
+    if (what == CURL_POLL_REMOVE) {
+        events = PXSHOT_POLL_REMOVE;
     } else {
-        /* Binary image data */
-        resp->data = buffer.data;
-        resp->data_len = buffer.len;
+        if (what & CURL_POLL_IN) events |= PXSHOT_POLL_IN;
+        if (what & CURL_POLL_OUT) events |= PXSHOT_POLL_OUT;
     }
-    
-    resp->error = PXSHOT_OK;
-    return resp;
+    client->loop_socket((int)s, events, client->loop_userdata);
+    return 0;
 }
 
-pxshot_response_t *pxshot_get_usage(pxshot_client_t *client, pxshot_usage_t **usage) {
-    pxshot_response_t *resp = pxshot_response_new();
-    if (!resp) return NULL;
-    
-    if (!client || !usage) {
-        pxshot_set_error(resp, PXSHOT_ERR_INVALID_ARG, "client and usage are required");
-        return resp;
+static int pxshot_loop_timer_cb(CURLM *multi, long timeout_ms, void *userp) {
+    (void)multi;
+    pxshot_client_t *client = (pxshot_client_t *)userp;
+    client->loop_kicked = false;
+    client->loop_timer(pxshot_loop_timeout(client, timeout_ms), client->loop_userdata);
+    return 0;
+}
+
+pxshot_error_t pxshot_loop_attach(pxshot_client_t *client,
+                                  pxshot_socket_cb on_socket,
+                                  pxshot_timer_cb on_timer,
+                                  void *userdata) {
+    if (!client || !on_socket != !on_timer) return PXSHOT_ERR_INVALID_ARG;
+    if (pxshot_pending(client) > 0) return PXSHOT_ERR_INVALID_ARG;
+
+    client->loop_socket = on_socket;
+    client->loop_timer = on_timer;
+    client->loop_userdata = userdata;
+    client->loop_kicked = false;
+
+    CURLM *multi = client->multi;
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, on_socket ? pxshot_loop_socket_cb : NULL);
+    curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, on_socket ? (void *)client : NULL);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, on_timer ? pxshot_loop_timer_cb : NULL);
+    curl_multi_setopt(multi, CURLMOPT_TIMERDATA, on_timer ? (void *)client : NULL);
+    return PXSHOT_OK;
+}
+
+/* Collect finished transfers and run their callbacks after a socket action */
+static int pxshot_loop_finish(pxshot_client_t *client, CURLMcode mc) {
+    if (mc != CURLM_OK) return -1;
+    pxshot_async_start_due(client);
+    pxshot_async_collect(client);
+    pxshot_async_check_guards(client);
+    pxshot_async_start_due(client);
+    pxshot_async_dispatch(client);
+    return (int)client->inflight_count;
+}
+
+int pxshot_loop_on_socket(pxshot_client_t *client, int fd, int events) {
+    if (!client || !client->loop_socket) return -1;
+
+    int mask = 0;
+    if (events & PXSHOT_POLL_IN) mask |= CURL_CSELECT_IN;
+    if (events & PXSHOT_POLL_OUT) mask |= CURL_CSELECT_OUT;
+    if (events & PXSHOT_POLL_ERR) mask |= CURL_CSELECT_ERR;
+
+    int running = 0;
+    CURLMcode mc = curl_multi_socket_action(client->multi, (curl_socket_t)fd, mask, &running);
+    return pxshot_loop_finish(client, mc);
+}
+
+int pxshot_loop_on_timeout(pxshot_client_t *client) {
+    if (!client || !client->loop_socket) return -1;
+
+    bool kicked = client->loop_kicked;
+    client->loop_kicked = false;
+
+    int running = 0;
+    CURLMcode mc = curl_multi_socket_action(client->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    int result = pxshot_loop_finish(client, mc);
+
+    /* A kick replaced curl's own deadline, and deferred and guarded requests need a wakeup */
+    if (kicked || client->deferred_count > 0 || client->guarded_inflight > 0) pxshot_loop_rearm(client);
+    return result;
+}
+
+/* Executor */
+
+typedef struct pxshot_job {
+    pxshot_screenshot_opts_t opts;
+    pxshot_job_cb on_complete;
+    void *userdata;
+    struct pxshot_job *prev;
+    struct pxshot_job *next;
+} pxshot_job_t;
+
+/* Per-worker deque: the owner works at the tail, thieves take from the head */
+typedef struct {
+    pthread_mutex_t lock;
+    pxshot_job_t *head;
+    pxshot_job_t *tail;
+    pthread_t thread;
+    pxshot_executor_t *executor;
+    size_t id;
+} pxshot_worker_t;
+
+struct pxshot_executor {
+    pxshot_client_t *client;
+    pxshot_worker_t *workers;
+    size_t worker_count;
+    size_t started;
+    atomic_size_t queued;           /* Jobs sitting in a deque */
+    atomic_size_t next_worker;      /* Round-robin submission target */
+    atomic_uint_fast64_t completed;
+    atomic_uint_fast64_t stolen;
+
+    pthread_mutex_t lock;           /* Guards outstanding, stopping and the conds */
+    pthread_cond_t work;
+    pthread_cond_t idle;
+    size_t outstanding;             /* Submitted and not yet completed */
+    bool stopping;
+};
+
+static void pxshot_deque_push(pxshot_worker_t *w, pxshot_job_t *job) {
+    pthread_mutex_lock(&w->lock);
+    job->next = NULL;
+    job->prev = w->tail;
+    if (w->tail) w->tail->next = job;
+    else w->head = job;
+    w->tail = job;
+    pthread_mutex_unlock(&w->lock);
+}
+
+static pxshot_job_t *pxshot_deque_pop(pxshot_worker_t *w, bool steal) {
+    pthread_mutex_lock(&w->lock);
+    pxshot_job_t *job = steal ? w->head : w->tail;
+    if (job) {
+        if (job->prev) job->prev->next = job->next;
+        else w->head = job->next;
+        if (job->next) job->next->prev = job->prev;
+        else w->tail = job->prev;
     }
-    
-    *usage = NULL;
-    
-    /* Build URL */
-    size_t url_len = strlen(client->base_url) + 32;
-    char *url = (char *)malloc(url_len);
-    if (!url) {
-        pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to allocate URL");
-        return resp;
+    pthread_mutex_unlock(&w->lock);
+    return job;
+}
+
+/* Take the newest job from our own deque, else the oldest from another's */
+static pxshot_job_t *pxshot_worker_take(pxshot_worker_t *w) {
+    pxshot_executor_t *ex = w->executor;
+    if (atomic_load(&ex->queued) == 0) return NULL;
+
+    pxshot_job_t *job = pxshot_deque_pop(w, false);
+    for (size_t i = 1; !job && i < ex->worker_count; i++) {
+        job = pxshot_deque_pop(&ex->workers[(w->id + i) % ex->worker_count], true);
+        if (job) atomic_fetch_add_explicit(&ex->stolen, 1, memory_order_relaxed);
     }
-    snprintf(url, url_len, "%s/v1/usage", client->base_url);
-    
-    /* Build auth header */
-    size_t auth_len = strlen(client->api_key) + 32;
-    char *auth_header = (char *)malloc(auth_len);
-    if (!auth_header) {
-        free(url);
-        pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to allocate header");
-        return resp;
+    if (job) atomic_fetch_sub(&ex->queued, 1);
+    return job;
+}
+
+static void *pxshot_worker_main(void *arg) {
+    pxshot_worker_t *w = (pxshot_worker_t *)arg;
+    pxshot_executor_t *ex = w->executor;
+
+    for (;;) {
+        pxshot_job_t *job = pxshot_worker_take(w);
+        if (job) {
+            pxshot_response_t *resp = pxshot_screenshot(ex->client, &job->opts);
+            job->on_complete(&job->opts, resp, job->userdata);
+            pxshot_mem_free(ex->client->alloc, job);
+            atomic_fetch_add_explicit(&ex->completed, 1, memory_order_relaxed);
+
+            pthread_mutex_lock(&ex->lock);
+            if (--ex->outstanding == 0) pthread_cond_broadcast(&ex->idle);
+            pthread_mutex_unlock(&ex->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&ex->lock);
+        while (atomic_load(&ex->queued) == 0 && !ex->stopping) {
+            pthread_cond_wait(&ex->work, &ex->lock);
+        }
+        bool done = atomic_load(&ex->queued) == 0 && ex->stopping;
+        pthread_mutex_unlock(&ex->lock);
+        if (done) break;
     }
-    snprintf(auth_header, auth_len, "Authorization: Bearer %s", client->api_key);
-    
-    /* Setup CURL */
-    CURL *curl = client->curl;
-    curl_easy_reset(curl);
-    
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, auth_header);
-    
-    pxshot_buffer_t buffer = {0};
-    
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, pxshot_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, client->timeout_ms);
-    
-    CURLcode res = curl_easy_perform(curl);
-    
-    curl_slist_free_all(headers);
-    free(auth_header);
-    free(url);
-    
-    if (res != CURLE_OK) {
-        free(buffer.data);
-        pxshot_set_error(resp, PXSHOT_ERR_CURL_PERFORM, curl_easy_strerror(res));
-        return resp;
+    return NULL;
+}
+
+pxshot_executor_t *pxshot_executor_new(pxshot_client_t *client, size_t workers) {
+    if (!client) return NULL;
+    if (workers == 0) workers = 4;
+
+    pxshot_executor_t *ex = (pxshot_executor_t *)pxshot_mem_calloc(client->alloc, 1, sizeof(pxshot_executor_t));
+    if (!ex) return NULL;
+    ex->workers = (pxshot_worker_t *)pxshot_mem_calloc(client->alloc, workers, sizeof(pxshot_worker_t));
+    if (!ex->workers || pthread_mutex_init(&ex->lock, NULL) != 0) {
+        pxshot_mem_free(client->alloc, ex->workers);
+        pxshot_mem_free(client->alloc, ex);
+        return NULL;
     }
-    
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    resp->http_status = (int)http_code;
-    
-    if (http_code >= 400) {
-        free(buffer.data);
-        pxshot_set_error(resp, PXSHOT_ERR_HTTP_ERROR, "HTTP error");
-        return resp;
+    pthread_cond_init(&ex->work, NULL);
+    pthread_cond_init(&ex->idle, NULL);
+    ex->client = client;
+    ex->worker_count = workers;
+
+    for (size_t i = 0; i < workers; i++) {
+        pthread_mutex_init(&ex->workers[i].lock, NULL);
+        ex->workers[i].executor = ex;
+        ex->workers[i].id = i;
     }
-    
-    /* Parse JSON response */
-    cJSON *json = cJSON_Parse((char *)buffer.data);
-    free(buffer.data);
-    
-    if (!json) {
-        pxshot_set_error(resp, PXSHOT_ERR_JSON_PARSE, "failed to parse response JSON");
-        return resp;
+
+    pxshot_pool_reserve(&client->pool, workers);
+
+    for (; ex->started < workers; ex->started++) {
+        pxshot_worker_t *w = &ex->workers[ex->started];
+        if (pthread_create(&w->thread, NULL, pxshot_worker_main, w) != 0) {
+            pxshot_executor_free(ex);
+            return NULL;
+        }
     }
-    
-    *usage = (pxshot_usage_t *)calloc(1, sizeof(pxshot_usage_t));
-    if (!*usage) {
-        cJSON_Delete(json);
-        pxshot_set_error(resp, PXSHOT_ERR_OUT_OF_MEMORY, "failed to allocate usage struct");
-        return resp;
+    return ex;
+}
+
+pxshot_error_t pxshot_executor_submit(pxshot_executor_t *executor,
+                                      const pxshot_screenshot_opts_t *opts,
+                                      pxshot_job_cb on_complete,
+                                      void *userdata) {
+    if (!executor || !opts || !on_complete) return PXSHOT_ERR_INVALID_ARG;
+
+    pxshot_job_t *job = (pxshot_job_t *)pxshot_mem_alloc(executor->client->alloc, sizeof(pxshot_job_t));
+    if (!job) return PXSHOT_ERR_OUT_OF_MEMORY;
+    job->opts = *opts;
+    job->on_complete = on_complete;
+    job->userdata = userdata;
+
+    pthread_mutex_lock(&executor->lock);
+    executor->outstanding++;
+    pthread_mutex_unlock(&executor->lock);
+
+    size_t target = atomic_fetch_add_explicit(&executor->next_worker, 1, memory_order_relaxed);
+    pxshot_deque_push(&executor->workers[target % executor->worker_count], job);
+    atomic_fetch_add(&executor->queued, 1);
+
+    pthread_mutex_lock(&executor->lock);
+    pthread_cond_signal(&executor->work);
+    pthread_mutex_unlock(&executor->lock);
+    return PXSHOT_OK;
+}
+
+void pxshot_executor_wait(pxshot_executor_t *executor) {
+    if (!executor) return;
+    pthread_mutex_lock(&executor->lock);
+    while (executor->outstanding > 0) {
+        pthread_cond_wait(&executor->idle, &executor->lock);
     }
-    
-    cJSON *item;
-    if ((item = cJSON_GetObjectItem(json, "screenshots_used")) && cJSON_IsNumber(item))
-        (*usage)->screenshots_used = item->valueint;
-    if ((item = cJSON_GetObjectItem(json, "screenshots_limit")) && cJSON_IsNumber(item))
-        (*usage)->screenshots_limit = item->valueint;
-    if ((item = cJSON_GetObjectItem(json, "storage_used_bytes")) && cJSON_IsNumber(item))
-        (*usage)->storage_used_bytes = item->valueint;
-    if ((item = cJSON_GetObjectItem(json, "storage_limit_bytes")) && cJSON_IsNumber(item))
-        (*usage)->storage_limit_bytes = item->valueint;
-    if ((item = cJSON_GetObjectItem(json, "period_start")) && cJSON_IsString(item))
-        (*usage)->period_start = pxshot_strdup(item->valuestring);
-    if ((item = cJSON_GetObjectItem(json, "period_end")) && cJSON_IsString(item))
-        (*usage)->period_end = pxshot_strdup(item->valuestring);
-    
-    cJSON_Delete(json);
-    resp->error = PXSHOT_OK;
-    return resp;
+    pthread_mutex_unlock(&executor->lock);
+}
+
+pxshot_error_t pxshot_executor_get_stats(pxshot_executor_t *executor, pxshot_executor_stats_t *stats) {
+    if (!executor || !stats) return PXSHOT_ERR_INVALID_ARG;
+
+    stats->workers = executor->worker_count;
+    stats->queued = atomic_load(&executor->queued);
+    stats->completed = atomic_load_explicit(&executor->completed, memory_order_relaxed);
+    stats->stolen = atomic_load_explicit(&executor->stolen, memory_order_relaxed);
+    return PXSHOT_OK;
+}
+
+void pxshot_executor_free(pxshot_executor_t *executor) {
+    if (!executor) return;
+
+    pthread_mutex_lock(&executor->lock);
+    executor->stopping = true;
+    pthread_cond_broadcast(&executor->work);
+    pthread_mutex_unlock(&executor->lock);
+
+    for (size_t i = 0; i < executor->started; i++) {
+        pthread_join(executor->workers[i].thread, NULL);
+    }
+    for (size_t i = 0; i < executor->worker_count; i++) {
+        pthread_mutex_destroy(&executor->workers[i].lock);
+    }
+    pthread_cond_destroy(&executor->work);
+    pthread_cond_destroy(&executor->idle);
+    pthread_mutex_destroy(&executor->lock);
+    pxshot_mem_free(executor->client->alloc, executor->workers);
+    pxshot_mem_free(executor->client->alloc, executor);
 }
 
 void pxshot_response_free(pxshot_response_t *resp) {
     if (!resp) return;
-    free(resp->error_message);
-    free(resp->data);
-    if (resp->stored) {
-        free(resp->stored->url);
-        free(resp->stored->expires_at);
-        free(resp->stored);
-    }
-    free(resp);
+    pxshot_response_release(resp);
+    pxshot_mem_free(pxshot_response_alloc(resp), resp);
 }
 
 void pxshot_usage_free(pxshot_usage_t *usage) {
     if (!usage) return;
-    free(usage->period_start);
-    free(usage->period_end);
-    free(usage);
+    pxshot_mem_free(((pxshot_usage_impl_t *)usage)->alloc, usage);
 }
 
 const char *pxshot_error_string(pxshot_error_t error) {
@@ -693,6 +5971,11 @@ const char *pxshot_error_string(pxshot_error_t error) {
         case PXSHOT_ERR_JSON_PARSE: return "JSON parse error";
         case PXSHOT_ERR_API_ERROR: return "API error";
         case PXSHOT_ERR_TIMEOUT: return "request timed out";
+        case PXSHOT_ERR_CANCELLED: return "request cancelled";
+        case PXSHOT_ERR_DEADLINE: return "request deadline exceeded";
+        case PXSHOT_ERR_CIRCUIT_OPEN: return "circuit open";
+        case PXSHOT_ERR_RATE_LIMITED: return "rate limited";
+        case PXSHOT_ERR_SINK_WRITE: return "sink write failed";
         default: return "unknown error";
     }
 }
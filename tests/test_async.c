@@ -0,0 +1,80 @@
+/**
+ * @file test_async.c
+ * @brief Asynchronous requests collected as futures
+ *
+ * Submits captures without callbacks and collects them both ways the
+ * README shows: pxshot_wait_any() followed by pxshot_request_finish(),
+ * and polling until pxshot_request_is_done(). Everything goes through a
+ * counting allocator, which must be balanced once the client is freed.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#define CAPTURES 4
+
+static long live;
+
+static void *counting_malloc(size_t size, void *ctx) {
+    (void)ctx;
+    live++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *ctx) {
+    (void)ctx;
+    if (!ptr) live++;
+    return realloc(ptr, size);
+}
+
+static void counting_free(void *ptr, void *ctx) {
+    (void)ctx;
+    if (ptr) live--;
+    free(ptr);
+}
+
+int main(void) {
+    int port = test_server_start(test_reply_png);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_allocator_t allocator = { counting_malloc, counting_realloc, counting_free, NULL };
+    pxshot_config_t config = { .api_key = "test", .base_url = base_url, .allocator = &allocator };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com" };
+
+    /* Futures handed out by pxshot_wait_any() */
+    for (int i = 0; i < CAPTURES; i++) CHECK(pxshot_submit(client, &opts, NULL, NULL));
+    int collected = 0;
+    pxshot_request_t *req;
+    while ((req = pxshot_wait_any(client, 5000))) {
+        CHECK(pxshot_request_is_done(req));
+        pxshot_response_t *resp = pxshot_request_finish(req);
+        CHECK(resp && resp->error == PXSHOT_OK && resp->data_len == 16);
+        pxshot_response_free(resp);
+        collected++;
+    }
+    CHECK(collected == CAPTURES);
+
+    /* Requests still linked to the client */
+    pxshot_request_t *reqs[CAPTURES];
+    for (int i = 0; i < CAPTURES; i++) CHECK((reqs[i] = pxshot_submit(client, &opts, NULL, NULL)));
+    for (int i = 0; i < CAPTURES; i++) {
+        while (!pxshot_request_is_done(reqs[i])) CHECK(pxshot_poll(client, 100) >= 0);
+        pxshot_response_t *resp = pxshot_request_finish(reqs[i]);
+        CHECK(resp && resp->error == PXSHOT_OK);
+        pxshot_response_free(resp);
+    }
+
+    /* Abandoned before completion */
+    CHECK(pxshot_request_finish(pxshot_submit(client, &opts, NULL, NULL)) == NULL);
+
+    pxshot_free(client);
+    CHECK(live == 0);
+    return 0;
+}
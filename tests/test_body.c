@@ -0,0 +1,87 @@
+/**
+ * @file test_body.c
+ * @brief Request bodies as they arrive at the server
+ *
+ * Sends captures whose URL and selector hold quotes, backslashes, control
+ * characters and non-ASCII UTF-8, through both the blocking and the
+ * asynchronous path, and compares the body the stand-in server receives
+ * byte for byte. One selector is long enough that the body no longer fits
+ * the inline storage.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static char received[4096];
+
+static bool reply_recording(int fd, const char *request) {
+    const char *body = strstr(request, "\r\n\r\n");
+    pthread_mutex_lock(&lock);
+    snprintf(received, sizeof(received), "%s", body ? body + 4 : "");
+    pthread_mutex_unlock(&lock);
+    return test_reply_png(fd, request);
+}
+
+static void check_received(const char *expected) {
+    pthread_mutex_lock(&lock);
+    if (strcmp(received, expected) != 0) {
+        fprintf(stderr, "expected %s\n     got %s\n", expected, received);
+        exit(1);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void check_body(pxshot_client_t *client, const pxshot_screenshot_opts_t *opts, const char *expected) {
+    pxshot_response_t *resp = pxshot_screenshot(client, opts);
+    CHECK(resp && resp->error == PXSHOT_OK);
+    pxshot_response_free(resp);
+    check_received(expected);
+
+    pxshot_request_t *req = pxshot_submit(client, opts, NULL, NULL);
+    CHECK(req);
+    CHECK(pxshot_wait_any(client, 5000) == req);
+    resp = pxshot_request_finish(req);
+    CHECK(resp && resp->error == PXSHOT_OK);
+    pxshot_response_free(resp);
+    check_received(expected);
+}
+
+int main(void) {
+    int port = test_server_start(reply_recording);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_client_t *client = pxshot_new_with_config(&(pxshot_config_t){ .api_key = "test", .base_url = base_url });
+    CHECK(client);
+
+    pxshot_screenshot_opts_t opts = {
+        .url = "https://example.com/?q=\"a\\b\"\n\x01\x1f\xc3\xa9\xe2\x82\xac",
+        .wait_for_selector = "div[title=\"caf\xc3\xa9\"]\t\r\b\f\\",
+        .width = 800
+    };
+    check_body(client, &opts,
+               "{\"url\":\"https://example.com/?q=\\\"a\\\\b\\\"\\n\\u0001\\u001f\xc3\xa9\xe2\x82\xac\","
+               "\"format\":\"png\",\"width\":800,"
+               "\"wait_for_selector\":\"div[title=\\\"caf\xc3\xa9\\\"]\\t\\r\\b\\f\\\\\"}");
+
+    /* Twice the inline storage, every character escaped */
+    char selector[PXSHOT_BODY_INLINE + 1];
+    char expected[4 * PXSHOT_BODY_INLINE];
+    memset(selector, '"', sizeof(selector) - 1);
+    selector[sizeof(selector) - 1] = '\0';
+    int n = snprintf(expected, sizeof(expected), "{\"url\":\"https://example.com\",\"format\":\"png\",\"wait_for_selector\":\"");
+    for (size_t i = 0; i < sizeof(selector) - 1; i++) {
+        expected[n++] = '\\';
+        expected[n++] = '"';
+    }
+    snprintf(expected + n, sizeof(expected) - (size_t)n, "\"}");
+    opts = (pxshot_screenshot_opts_t){ .url = "https://example.com", .wait_for_selector = selector };
+    check_body(client, &opts, expected);
+
+    pxshot_free(client);
+    return 0;
+}
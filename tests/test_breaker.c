@@ -0,0 +1,100 @@
+/**
+ * @file test_breaker.c
+ * @brief Circuit breaker on the screenshot endpoint
+ *
+ * The stand-in server answers 503 while it is marked down. Enough
+ * failures must open the circuit, after which captures fail with
+ * PXSHOT_ERR_CIRCUIT_OPEN without reaching the server. After open_ms a
+ * probe goes through: a failed one reopens the circuit, a successful one
+ * closes it.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <stdatomic.h>
+
+#define OPEN_MS 200
+
+static atomic_bool down;
+static atomic_int hits;
+
+static bool reply_when_up(int fd, const char *request) {
+    atomic_fetch_add(&hits, 1);
+    if (atomic_load(&down)) {
+        static const char busy[] = "{\"error\":\"busy\"}";
+        return test_respond(fd, 503, "Content-Type: application/json\r\n", busy, sizeof(busy) - 1);
+    }
+    return test_reply_png(fd, request);
+}
+
+static pxshot_error_t capture(pxshot_client_t *client) {
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com" };
+    pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+    CHECK(resp);
+    pxshot_error_t err = resp->error;
+    pxshot_response_free(resp);
+    return err;
+}
+
+static pxshot_circuit_stats_t circuit(pxshot_client_t *client) {
+    pxshot_circuit_stats_t stats;
+    CHECK(pxshot_get_circuit_stats(client, PXSHOT_API_SCREENSHOT, &stats) == PXSHOT_OK);
+    return stats;
+}
+
+int main(void) {
+    int port = test_server_start(reply_when_up);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .circuit = { .failure_ratio = 0.5, .min_requests = 4, .open_ms = OPEN_MS }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    CHECK(capture(client) == PXSHOT_OK);
+    CHECK(circuit(client).state == PXSHOT_CIRCUIT_CLOSED);
+
+    /* Three failures out of four requests open it */
+    atomic_store(&down, true);
+    for (int i = 0; i < 3; i++) CHECK(capture(client) == PXSHOT_ERR_HTTP_ERROR);
+    CHECK(circuit(client).state == PXSHOT_CIRCUIT_OPEN);
+    CHECK(circuit(client).opened == 1);
+
+    /* Open: nothing reaches the server, blocking or asynchronous */
+    atomic_store(&hits, 0);
+    CHECK(capture(client) == PXSHOT_ERR_CIRCUIT_OPEN);
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com" };
+    pxshot_request_t *req = pxshot_submit(client, &opts, NULL, NULL);
+    CHECK(req && pxshot_request_is_done(req));
+    pxshot_response_t *resp = pxshot_request_finish(req);
+    CHECK(resp && resp->error == PXSHOT_ERR_CIRCUIT_OPEN);
+    pxshot_response_free(resp);
+    CHECK(atomic_load(&hits) == 0);
+    CHECK(circuit(client).rejected == 2);
+
+    /* A failed probe reopens it */
+    usleep((OPEN_MS + 50) * 1000);
+    CHECK(capture(client) == PXSHOT_ERR_HTTP_ERROR);
+    CHECK(atomic_load(&hits) == 1);
+    CHECK(circuit(client).state == PXSHOT_CIRCUIT_OPEN);
+    CHECK(circuit(client).opened == 2);
+    CHECK(capture(client) == PXSHOT_ERR_CIRCUIT_OPEN);
+
+    /* A successful one closes it */
+    atomic_store(&down, false);
+    usleep((OPEN_MS + 50) * 1000);
+    CHECK(capture(client) == PXSHOT_OK);
+    CHECK(circuit(client).state == PXSHOT_CIRCUIT_CLOSED);
+    CHECK(capture(client) == PXSHOT_OK);
+
+    pxshot_free(client);
+    return 0;
+}
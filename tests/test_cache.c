@@ -0,0 +1,94 @@
+/**
+ * @file test_cache.c
+ * @brief In-memory screenshot cache
+ *
+ * Repeated captures must be answered from the cache without reaching the
+ * stand-in server, through both the blocking and asynchronous paths,
+ * until the TTL passes. A small budget must evict the least recently
+ * used images first.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <stdatomic.h>
+
+#define TTL_MS 200
+
+static atomic_int hits;
+
+static bool reply_counting(int fd, const char *request) {
+    atomic_fetch_add(&hits, 1);
+    return test_reply_png(fd, request);
+}
+
+/* Capture url; returns whether the answer came from the cache */
+static bool capture(pxshot_client_t *client, const char *url) {
+    pxshot_screenshot_opts_t opts = { .url = url };
+    int before = atomic_load(&hits);
+    pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+    CHECK(resp && resp->error == PXSHOT_OK);
+    CHECK(resp->data_len == 16 && memcmp(resp->data, "\x89PNG0123456789ab", 16) == 0);
+    bool cached = resp->cached;
+    CHECK(atomic_load(&hits) == before + (cached ? 0 : 1));
+    pxshot_response_free(resp);
+    return cached;
+}
+
+int main(void) {
+    int port = test_server_start(reply_counting);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .cache = { .max_bytes = 1 << 20, .ttl_ms = TTL_MS }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    CHECK(!capture(client, "https://example.com"));
+    CHECK(capture(client, "https://example.com"));
+    CHECK(!capture(client, "https://example.com/other"));
+
+    /* A submitted capture is answered at once */
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com" };
+    pxshot_request_t *req = pxshot_submit(client, &opts, NULL, NULL);
+    CHECK(req && pxshot_request_is_done(req));
+    pxshot_response_t *resp = pxshot_request_finish(req);
+    CHECK(resp && resp->error == PXSHOT_OK && resp->cached && resp->data_len == 16);
+    pxshot_response_free(resp);
+
+    pxshot_cache_stats_t stats;
+    CHECK(pxshot_get_cache_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.hits == 2 && stats.misses == 2 && stats.entries == 2);
+
+    /* Expired entries are fetched again */
+    usleep((TTL_MS + 50) * 1000);
+    CHECK(!capture(client, "https://example.com"));
+    CHECK(capture(client, "https://example.com"));
+    CHECK(pxshot_get_cache_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.expirations == 1);
+    pxshot_free(client);
+
+    /* Room for a few images: the oldest go first */
+    config.cache = (pxshot_cache_policy_t){ .max_bytes = 1024, .shards = 1 };
+    client = pxshot_new_with_config(&config);
+    CHECK(client);
+    char url[64];
+    for (int i = 0; i < 20; i++) {
+        snprintf(url, sizeof(url), "https://example.com/%d", i);
+        CHECK(!capture(client, url));
+    }
+    CHECK(pxshot_get_cache_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.evictions > 0 && stats.entries > 0 && stats.entries < 20);
+    CHECK(stats.bytes <= 1024);
+    CHECK(capture(client, url));
+    CHECK(!capture(client, "https://example.com/0"));
+    pxshot_free(client);
+    return 0;
+}
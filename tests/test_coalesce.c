@@ -0,0 +1,82 @@
+/**
+ * @file test_coalesce.c
+ * @brief Identical concurrent captures share one request
+ *
+ * Several threads capture the same options at once against a slow
+ * stand-in server. The server must see exactly one request, and every
+ * thread must get the image. Captures with different options still go out
+ * separately.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <stdatomic.h>
+
+#define THREADS 8
+
+static atomic_int hits;
+static pthread_barrier_t barrier;
+static pxshot_client_t *client;
+
+static bool reply_slow(int fd, const char *request) {
+    atomic_fetch_add(&hits, 1);
+    usleep(300 * 1000);
+    return test_reply_png(fd, request);
+}
+
+static void *capture(void *arg) {
+    pxshot_screenshot_opts_t opts = { .url = (const char *)arg, .width = 1280 };
+    pthread_barrier_wait(&barrier);
+    pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+    CHECK(resp && resp->error == PXSHOT_OK);
+    CHECK(resp->data_len == 16 && memcmp(resp->data, "\x89PNG", 4) == 0);
+    pxshot_response_free(resp);
+    return NULL;
+}
+
+/* Run THREADS captures at once, thread i of url urls[i % 2] */
+static void run(const char *const urls[2]) {
+    pthread_t threads[THREADS];
+    CHECK(pthread_barrier_init(&barrier, NULL, THREADS) == 0);
+    for (int i = 0; i < THREADS; i++) {
+        CHECK(pthread_create(&threads[i], NULL, capture, (void *)urls[i % 2]) == 0);
+    }
+    for (int i = 0; i < THREADS; i++) pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&barrier);
+}
+
+int main(void) {
+    int port = test_server_start(reply_slow);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_config_t config = { .api_key = "test", .base_url = base_url, .coalesce = true };
+    client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    static const char *const same[2] = { "https://example.com", "https://example.com" };
+    run(same);
+    CHECK(atomic_load(&hits) == 1);
+    pxshot_transport_stats_t stats;
+    CHECK(pxshot_get_transport_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.coalesced == THREADS - 1);
+
+    /* Two sets of options: one request each */
+    atomic_store(&hits, 0);
+    static const char *const two[2] = { "https://example.com/a", "https://example.com/b" };
+    run(two);
+    CHECK(atomic_load(&hits) == 2);
+
+    /* Once the capture has landed, a repeat is a new request */
+    atomic_store(&hits, 0);
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com", .width = 1280 };
+    pxshot_response_free(pxshot_screenshot(client, &opts));
+    CHECK(atomic_load(&hits) == 1);
+
+    pxshot_free(client);
+    return 0;
+}
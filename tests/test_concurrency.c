@@ -0,0 +1,97 @@
+/**
+ * @file test_concurrency.c
+ * @brief Adaptive concurrency limit for asynchronous captures
+ *
+ * Submits more captures than the limit allows to a stand-in server that
+ * records how many requests it is serving at once. Requests over the
+ * limit must wait unstarted, the server must never see more than
+ * max_limit at a time, and every capture must still complete. Transient
+ * errors must then shrink the limit.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <stdatomic.h>
+
+#define CAPTURES 24
+#define MAX_LIMIT 4
+
+static atomic_int serving;
+static atomic_int most_serving;
+
+static bool reply_counting(int fd, const char *request) {
+    int now = atomic_fetch_add(&serving, 1) + 1;
+    int most = atomic_load(&most_serving);
+    while (now > most && !atomic_compare_exchange_weak(&most_serving, &most, now)) {}
+    usleep(20 * 1000);
+    atomic_fetch_sub(&serving, 1);
+    if (strstr(request, "https://busy")) {
+        static const char busy[] = "{\"error\":\"busy\"}";
+        return test_respond(fd, 503, "Content-Type: application/json\r\n", busy, sizeof(busy) - 1);
+    }
+    return test_reply_png(fd, request);
+}
+
+static void on_complete(pxshot_request_t *req, pxshot_response_t *resp, void *userdata) {
+    (void)req;
+    int *counts = (int *)userdata;
+    counts[resp->error == PXSHOT_OK ? 0 : 1]++;
+    pxshot_response_free(resp);
+}
+
+/* Submit CAPTURES of url and poll until they are done; counts[0] ok, counts[1] failed */
+static void run(pxshot_client_t *client, const char *url, int counts[2]) {
+    pxshot_screenshot_opts_t opts = { .url = url };
+    for (int i = 0; i < CAPTURES; i++) CHECK(pxshot_submit(client, &opts, on_complete, counts));
+
+    pxshot_concurrency_stats_t stats;
+    CHECK(pxshot_get_concurrency_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.active <= MAX_LIMIT);
+    CHECK(stats.active + stats.waiting == CAPTURES);
+
+    while (pxshot_poll(client, 1000) > 0) {
+        CHECK(pxshot_get_concurrency_stats(client, &stats) == PXSHOT_OK);
+        CHECK(stats.active <= MAX_LIMIT);
+    }
+    CHECK(counts[0] + counts[1] == CAPTURES);
+}
+
+int main(void) {
+    int port = test_server_start(reply_counting);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .concurrency = { .adaptive = true, .initial_limit = 2, .max_limit = MAX_LIMIT }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    int counts[2] = {0};
+    run(client, "https://example.com", counts);
+    CHECK(counts[0] == CAPTURES);
+    CHECK(atomic_load(&most_serving) <= MAX_LIMIT);
+    CHECK(atomic_load(&most_serving) >= 2);
+
+    pxshot_concurrency_stats_t stats;
+    CHECK(pxshot_get_concurrency_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.limit > 2);             /* Grew from initial_limit with latency steady */
+    CHECK(stats.backoffs == 0);
+
+    /* Every 503 backs the limit off, down to min_limit */
+    counts[0] = counts[1] = 0;
+    run(client, "https://busy", counts);
+    CHECK(counts[1] == CAPTURES);
+    CHECK(pxshot_get_concurrency_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.backoffs == CAPTURES);
+    CHECK(stats.limit == 1);
+
+    pxshot_free(client);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file test_content_length.c
+ * @brief Body buffers sized from hostile or wrong Content-Length headers
+ *
+ * The stand-in server announces lengths that overflow size_t, are
+ * negative, are far larger than the body it sends, or are correct. No
+ * capture may write past its buffer or allocate anywhere near the
+ * announced size, and the honest one must still arrive intact. Both with
+ * and without the buffer pool.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#define BODY_LEN 5000
+
+static size_t largest;
+
+static void *tracking_malloc(size_t size, void *ctx) {
+    (void)ctx;
+    if (size > largest) largest = size;
+    return malloc(size);
+}
+
+static void *tracking_realloc(void *ptr, size_t size, void *ctx) {
+    (void)ctx;
+    if (size > largest) largest = size;
+    return realloc(ptr, size);
+}
+
+static void tracking_free(void *ptr, void *ctx) {
+    (void)ctx;
+    free(ptr);
+}
+
+/* The capture URL in the request body picks the announced length */
+static bool reply_announced(int fd, const char *request) {
+    const char *length = "5000";
+    if (strstr(request, "https://overflow")) length = "18446744073709551615";
+    else if (strstr(request, "https://huge")) length = "3000000000";
+    else if (strstr(request, "https://negative")) length = "-1";
+    else if (strstr(request, "https://junk")) length = "99999999999999999999999";
+
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 200 OK\r\n"
+                     "Content-Type: image/png\r\n"
+                     "Content-Length: %s\r\n"
+                     "\r\n", length);
+    static char body[BODY_LEN];
+    memset(body, 'x', sizeof(body));
+    memcpy(body, "\x89PNG", 4);
+    if (!test_send(fd, head, (size_t)n) || !test_send(fd, body, sizeof(body))) return false;
+    return strcmp(length, "5000") == 0;
+}
+
+static void run(const char *base_url, size_t pool_bytes) {
+    pxshot_allocator_t allocator = { tracking_malloc, tracking_realloc, tracking_free, NULL };
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .allocator = &allocator,
+        .buffer_pool = { .max_bytes = pool_bytes }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    static const char *const liars[] = {
+        "https://overflow", "https://huge", "https://negative", "https://junk"
+    };
+    for (size_t i = 0; i < sizeof(liars) / sizeof(liars[0]); i++) {
+        largest = 0;
+        pxshot_screenshot_opts_t opts = { .url = liars[i] };
+        pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+        CHECK(resp);
+        /* The body ends early for the oversized lengths; it must not have been trusted */
+        CHECK(resp->error != PXSHOT_OK || resp->data_len == BODY_LEN);
+        CHECK(largest <= PXSHOT_PRESIZE_MAX);
+        pxshot_response_free(resp);
+    }
+
+    pxshot_screenshot_opts_t opts = { .url = "https://honest" };
+    pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+    CHECK(resp && resp->error == PXSHOT_OK);
+    CHECK(resp->data_len == BODY_LEN && memcmp(resp->data, "\x89PNG", 4) == 0);
+    if (!pool_bytes) CHECK(resp->reallocs == 0);
+    pxshot_response_free(resp);
+
+    pxshot_free(client);
+}
+
+int main(void) {
+    int port = test_server_start(reply_announced);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    run(base_url, 0);
+    /* Pooled buffers come in size classes, which must still hold the body */
+    run(base_url, (size_t)64 << 20);
+    return 0;
+}
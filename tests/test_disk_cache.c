@@ -0,0 +1,135 @@
+/**
+ * @file test_disk_cache.c
+ * @brief Persistent on-disk screenshot cache
+ *
+ * Checks that identical images share one file, that the cache answers
+ * captures again after the client is reopened, and that under eviction
+ * churn from several threads every image the index names is still on
+ * disk.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <dirent.h>
+#include <stdatomic.h>
+
+#define THREADS 8
+#define IMAGES 6
+
+static atomic_int hits;
+static char dir[] = "/tmp/pxshot_disk_XXXXXX";
+
+static void remove_tree(const char *path) {
+    DIR *d = opendir(path);
+    if (d) {
+        char child[PXSHOT_DISK_PATH_MAX];
+        for (struct dirent *e; (e = readdir(d));) {
+            if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+            snprintf(child, sizeof(child), "%s/%s", path, e->d_name);
+            remove_tree(child);
+        }
+        closedir(d);
+    }
+    remove(path);
+}
+
+static void cleanup(void) {
+    remove_tree(dir);
+}
+
+/* https://img/N gets image N; anything else the default image */
+static bool reply_images(int fd, const char *request) {
+    atomic_fetch_add(&hits, 1);
+    const char *n = strstr(request, "https://img/");
+    if (!n) return test_reply_png(fd, request);
+    char body[16];
+    memcpy(body, "\x89PNG0123456789a", 15);
+    body[15] = n[12];
+    return test_respond(fd, 200, "Content-Type: image/png\r\n", body, sizeof(body));
+}
+
+static pxshot_client_t *open_client(const char *base_url, uint64_t max_bytes) {
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .disk_cache = { .dir = dir, .max_bytes = max_bytes }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client && client->disk);
+    return client;
+}
+
+/* Capture url; returns whether the answer came from the cache */
+static bool capture(pxshot_client_t *client, const char *url) {
+    pxshot_screenshot_opts_t opts = { .url = url };
+    pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+    CHECK(resp && resp->error == PXSHOT_OK && resp->data_len == 16);
+    CHECK(memcmp(resp->data, "\x89PNG", 4) == 0);
+    bool cached = resp->cached;
+    pxshot_response_free(resp);
+    return cached;
+}
+
+static void *churn(void *arg) {
+    pxshot_client_t *client = (pxshot_client_t *)arg;
+    unsigned seed = (unsigned)(uintptr_t)pthread_self();
+    char url[32];
+    for (int i = 0; i < 300; i++) {
+        int n = rand_r(&seed) % IMAGES;
+        snprintf(url, sizeof(url), "https://img/%d?v=%d", n, rand_r(&seed) % 4);
+        capture(client, url);
+    }
+    return NULL;
+}
+
+int main(void) {
+    int port = test_server_start(reply_images);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+    CHECK(mkdtemp(dir));
+    atexit(cleanup);
+
+    /* Two option sets with the same image share its file */
+    pxshot_client_t *client = open_client(base_url, 0);
+    CHECK(!capture(client, "https://example.com/a"));
+    CHECK(!capture(client, "https://example.com/b"));
+    CHECK(capture(client, "https://example.com/a"));
+    pxshot_disk_cache_stats_t stats;
+    CHECK(pxshot_get_disk_cache_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.entries == 2 && stats.files == 1 && stats.bytes == 16 && stats.hits == 1);
+    pxshot_free(client);
+
+    /* Reopened, it still answers without the server */
+    atomic_store(&hits, 0);
+    client = open_client(base_url, 0);
+    CHECK(capture(client, "https://example.com/a"));
+    CHECK(capture(client, "https://example.com/b"));
+    CHECK(atomic_load(&hits) == 0);
+    pxshot_free(client);
+
+    /* Room for two images: threads evict each other's constantly */
+    client = open_client(base_url, 32);
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) CHECK(pthread_create(&threads[i], NULL, churn, client) == 0);
+    for (int i = 0; i < THREADS; i++) pthread_join(threads[i], NULL);
+    CHECK(pxshot_get_disk_cache_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.evictions > 0 && stats.bytes <= 32);
+
+    /* Every image still indexed has its file */
+    pxshot_disk_t *disk = client->disk;
+    char path[PXSHOT_DISK_PATH_MAX];
+    for (const pxshot_disk_entry_t *entry = disk->head; entry; entry = entry->next) {
+        struct stat st;
+        pxshot_disk_path(disk, entry->object->id, path);
+        if (stat(path, &st) != 0) {
+            fprintf(stderr, "indexed image missing: %s\n", path);
+            return 1;
+        }
+    }
+    pxshot_free(client);
+    return 0;
+}
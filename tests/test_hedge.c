@@ -0,0 +1,71 @@
+/**
+ * @file test_hedge.c
+ * @brief Hedged blocking captures
+ *
+ * After a few fast captures set the latency threshold, the stand-in
+ * server stalls the first request for one URL and answers the duplicate
+ * at once. The capture must come back with the hedge's answer well before
+ * the stalled reply, and the statistics must show one hedge that won.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <stdatomic.h>
+
+#define WARMUP 8
+#define STALL_MS 2000
+
+static atomic_int slow_hits;
+
+static bool reply_stalling(int fd, const char *request) {
+    if (strstr(request, "https://slow") && atomic_fetch_add(&slow_hits, 1) == 0) {
+        usleep(STALL_MS * 1000);
+    }
+    return test_reply_png(fd, request);
+}
+
+int main(void) {
+    int port = test_server_start(reply_stalling);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .pool_max = 2,
+        .hedge = { .percentile = 0.5, .min_delay_ms = 50, .max_rate = 1.0, .min_samples = WARMUP }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    pxshot_transport_stats_t stats;
+    pxshot_screenshot_opts_t opts = { .url = "https://fast" };
+    for (int i = 0; i < WARMUP; i++) {
+        pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+        CHECK(resp && resp->error == PXSHOT_OK);
+        pxshot_response_free(resp);
+    }
+    CHECK(pxshot_get_transport_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.hedges == 0);
+
+    opts.url = "https://slow";
+    uint64_t start = pxshot_now_ms();
+    pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+    uint64_t elapsed = pxshot_now_ms() - start;
+    CHECK(resp && resp->error == PXSHOT_OK && resp->data_len == 16);
+    pxshot_response_free(resp);
+    CHECK(elapsed < STALL_MS / 2);
+    CHECK(atomic_load(&slow_hits) == 2);
+
+    CHECK(pxshot_get_transport_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.hedges == 1);
+    CHECK(stats.hedge_wins == 1);
+    CHECK(stats.requests == WARMUP + 1);
+
+    pxshot_free(client);
+    return 0;
+}
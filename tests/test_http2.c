@@ -0,0 +1,170 @@
+/**
+ * @file test_http2.c
+ * @brief HTTP/2 multiplexing over one connection
+ *
+ * Puts nghttpx, terminating TLS and speaking HTTP/2, in front of the local
+ * stand-in server and runs a batch of slow captures through it. With http2
+ * set the whole batch must share a single connection, every stream side by
+ * side with the others; without it every capture opens its own. Captures
+ * sent one after another reuse the connection without counting as
+ * multiplexed.
+ *
+ * Usage: test_http2 <nghttpx> <openssl>
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+
+#define CAPTURES 16
+
+static pid_t proxy;
+static char dir[] = "/tmp/pxshot_h2_XXXXXX";
+static char key[64], cert[64];
+
+/* Stop the proxy and remove its files, also when a check fails */
+static void cleanup(void) {
+    if (proxy > 0) {
+        kill(proxy, SIGTERM);
+        waitpid(proxy, NULL, 0);
+    }
+    unlink(key);
+    unlink(cert);
+    rmdir(dir);
+}
+
+/* Slow enough that the whole batch is in flight at once */
+static bool reply_slow(int fd, const char *request) {
+    usleep(200 * 1000);
+    return test_reply_png(fd, request);
+}
+
+static void on_item(size_t index, pxshot_response_t *resp, void *userdata) {
+    (void)index;
+    CHECK(resp->error == PXSHOT_OK);
+    (*(int *)userdata)++;
+    pxshot_response_free(resp);
+}
+
+/* An unused loopback port for the proxy */
+static int free_port(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    int port = -1;
+    if (fd >= 0 && bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    if (fd >= 0) close(fd);
+    return port;
+}
+
+static bool port_open(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port),
+                                .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    bool open = fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    if (fd >= 0) close(fd);
+    return open;
+}
+
+/* Run the batch, concurrency at a time; returns the transport statistics */
+static pxshot_transport_stats_t run_batch(const char *base_url, bool http2, size_t concurrency) {
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .http2 = http2,
+        .pool_size = CAPTURES,
+        .pool_max = CAPTURES,
+        .ca_file = cert             /* The proxy's certificate is self-signed */
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    pxshot_screenshot_opts_t opts[CAPTURES];
+    for (int i = 0; i < CAPTURES; i++) opts[i] = (pxshot_screenshot_opts_t){ .url = "https://example.com" };
+    int completed = 0;
+    CHECK(pxshot_screenshot_batch(client, opts, CAPTURES, concurrency, on_item, &completed, NULL) == PXSHOT_OK);
+    CHECK(completed == CAPTURES);
+
+    pxshot_transport_stats_t stats;
+    CHECK(pxshot_get_transport_stats(client, &stats) == PXSHOT_OK);
+    pxshot_free(client);
+    return stats;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) return TEST_SKIP;
+
+    CHECK(mkdtemp(dir));
+    atexit(cleanup);
+    char cmd[512];
+    snprintf(key, sizeof(key), "%s/key.pem", dir);
+    snprintf(cert, sizeof(cert), "%s/cert.pem", dir);
+    snprintf(cmd, sizeof(cmd),
+             "'%s' req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=localhost "
+             "-addext subjectAltName=IP:127.0.0.1 -keyout %s -out %s >/dev/null 2>&1",
+             argv[2], key, cert);
+    CHECK(system(cmd) == 0);
+
+    int backend = test_server_start(reply_slow);
+    int frontend = free_port();
+    CHECK(backend > 0 && frontend > 0);
+
+    char front[64], back[64];
+    snprintf(front, sizeof(front), "127.0.0.1,%d", frontend);
+    snprintf(back, sizeof(back), "127.0.0.1,%d", backend);
+    proxy = fork();
+    CHECK(proxy >= 0);
+    if (proxy == 0) {
+        execl(argv[1], argv[1], "-f", front, "-b", back, "--workers=1", "--log-level=ERROR",
+              "--errorlog-file=/dev/null", "--accesslog-file=/dev/null", key, cert, (char *)NULL);
+        _exit(127);
+    }
+
+    bool ready = false;
+    for (int i = 0; i < 100 && !ready; i++) {
+        usleep(50 * 1000);
+        ready = port_open(frontend);
+    }
+
+    int status = 1;
+    if (ready) {
+        char base_url[64];
+        snprintf(base_url, sizeof(base_url), "https://127.0.0.1:%d", frontend);
+
+        pxshot_transport_stats_t h2 = run_batch(base_url, true, CAPTURES);
+        printf("http2: %llu requests, %llu connections, %llu streams, %llu multiplexed\n",
+               (unsigned long long)h2.requests, (unsigned long long)h2.connections,
+               (unsigned long long)h2.http2_streams, (unsigned long long)h2.http2_multiplexed);
+        CHECK(h2.requests == CAPTURES);
+        CHECK(h2.connections == 1);
+        CHECK(h2.http2_streams == CAPTURES);
+        CHECK(h2.http2_multiplexed == CAPTURES);
+
+        /* One at a time: the connection is reused but never shared */
+        pxshot_transport_stats_t serial = run_batch(base_url, true, 1);
+        printf("http2 serial: %llu connections, %llu streams, %llu multiplexed\n",
+               (unsigned long long)serial.connections, (unsigned long long)serial.http2_streams,
+               (unsigned long long)serial.http2_multiplexed);
+        CHECK(serial.connections == 1);
+        CHECK(serial.http2_streams == CAPTURES);
+        CHECK(serial.http2_multiplexed == 0);
+
+        /* Without the flag each concurrent capture opens its own connection */
+        pxshot_transport_stats_t plain = run_batch(base_url, false, CAPTURES);
+        printf("default: %llu requests, %llu connections\n",
+               (unsigned long long)plain.requests, (unsigned long long)plain.connections);
+        CHECK(plain.connections == CAPTURES);
+        status = 0;
+    } else {
+        fprintf(stderr, "nghttpx did not start\n");
+    }
+
+    return status;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file test_locale.c
+ * @brief Request bodies under a locale with a comma decimal separator
+ *
+ * Applications that call setlocale(LC_ALL, "") may run with a locale
+ * whose decimal point is ','. The body must still carry '.' in numbers.
+ * Skipped when no such locale is installed; PXSHOT_TEST_LOCALE names one
+ * to try first.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <locale.h>
+
+static bool comma_locale(void) {
+    static const char *const names[] = {
+        "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "nl_NL.UTF-8", "de_DE", "fr_FR"
+    };
+    const char *env = getenv("PXSHOT_TEST_LOCALE");
+    if (env && setlocale(LC_NUMERIC, env) && strcmp(localeconv()->decimal_point, ",") == 0) return true;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (setlocale(LC_NUMERIC, names[i]) && strcmp(localeconv()->decimal_point, ",") == 0) return true;
+    }
+    return false;
+}
+
+static void check_scale(double scale, const char *expected) {
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com", .device_scale_factor = scale };
+    char storage[PXSHOT_BODY_INLINE];
+    char *body = pxshot_build_body(pxshot_global_allocator, &opts, storage, sizeof(storage));
+    CHECK(body);
+    if (!strstr(body, expected)) {
+        fprintf(stderr, "expected %s in %s\n", expected, body);
+        exit(1);
+    }
+    if (body != storage) pxshot_mem_free(pxshot_global_allocator, body);
+}
+
+int main(void) {
+    if (!comma_locale()) {
+        fprintf(stderr, "no locale with a comma decimal point\n");
+        return TEST_SKIP;
+    }
+
+    check_scale(1.5, "\"device_scale_factor\":1.5}");
+    check_scale(2, "\"device_scale_factor\":2}");
+    check_scale(0.1 + 0.2, "\"device_scale_factor\":0.30000000000000004}");
+    check_scale(1e-7, "\"device_scale_factor\":1e-07}");
+    return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file test_loop.c
+ * @brief Cancellation noticed promptly under an external event loop
+ *
+ * Drives the engine from a poll() loop built on pxshot_loop_attach(). The
+ * stand-in server never answers, so the transfer sits idle; the loop
+ * timer must still fire often enough that cancelling the request ends it
+ * within a few guard intervals instead of at curl's next deadline.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <poll.h>
+
+#define MAX_FDS 16
+
+static struct pollfd fds[MAX_FDS];
+static int nfds;
+static long timer_ms = -1;
+static bool completed;
+static pxshot_error_t result;
+
+/* Accept the request and never answer it */
+static bool reply_never(int fd, const char *request) {
+    (void)fd;
+    (void)request;
+    sleep(10);
+    return false;
+}
+
+static void on_socket(int fd, int events, void *userdata) {
+    (void)userdata;
+    int i = 0;
+    while (i < nfds && fds[i].fd != fd) i++;
+    if (events & PXSHOT_POLL_REMOVE) {
+        if (i < nfds) fds[i] = fds[--nfds];
+        return;
+    }
+    if (i == nfds) {
+        CHECK(nfds < MAX_FDS);
+        nfds++;
+    }
+    fds[i].fd = fd;
+    fds[i].events = (short)(((events & PXSHOT_POLL_IN) ? POLLIN : 0) | ((events & PXSHOT_POLL_OUT) ? POLLOUT : 0));
+}
+
+static void on_timer(long timeout_ms, void *userdata) {
+    (void)userdata;
+    timer_ms = timeout_ms;
+}
+
+static void on_complete(pxshot_request_t *req, pxshot_response_t *resp, void *userdata) {
+    (void)req;
+    (void)userdata;
+    completed = true;
+    result = resp->error;
+    pxshot_response_free(resp);
+}
+
+/* One loop iteration: wait for a socket or the timer, then hand it over */
+static void loop_once(pxshot_client_t *client) {
+    uint64_t armed = pxshot_now_ms();
+    long wait_ms = timer_ms;
+    int ready = poll(fds, (nfds_t)nfds, (int)wait_ms);
+    CHECK(ready >= 0);
+    for (int i = 0; i < nfds && ready > 0; i++) {
+        if (!fds[i].revents) continue;
+        int events = 0;
+        if (fds[i].revents & POLLIN) events |= PXSHOT_POLL_IN;
+        if (fds[i].revents & POLLOUT) events |= PXSHOT_POLL_OUT;
+        if (fds[i].revents & (POLLERR | POLLHUP)) events |= PXSHOT_POLL_ERR;
+        ready--;
+        pxshot_loop_on_socket(client, fds[i].fd, events);
+    }
+    if (wait_ms >= 0 && pxshot_now_ms() - armed >= (uint64_t)wait_ms) {
+        timer_ms = -1;
+        pxshot_loop_on_timeout(client);
+    }
+}
+
+int main(void) {
+    int port = test_server_start(reply_never);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_client_t *client = pxshot_new_with_config(&(pxshot_config_t){ .api_key = "test", .base_url = base_url });
+    CHECK(client);
+    CHECK(pxshot_loop_attach(client, on_socket, on_timer, NULL) == PXSHOT_OK);
+
+    pxshot_cancel_t *cancel = pxshot_cancel_new();
+    CHECK(cancel);
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com", .cancel = cancel };
+    CHECK(pxshot_submit(client, &opts, on_complete, NULL));
+
+    /* Let the request reach the server and go idle */
+    uint64_t start = pxshot_now_ms();
+    while (pxshot_now_ms() - start < 300) {
+        loop_once(client);
+        CHECK(!completed);
+        CHECK(timer_ms >= 0 && timer_ms <= PXSHOT_GUARD_POLL_MS);
+    }
+
+    pxshot_cancel_trigger(cancel);
+    uint64_t cancelled = pxshot_now_ms();
+    while (!completed && pxshot_now_ms() - cancelled < 2000) loop_once(client);
+    CHECK(completed);
+    CHECK(result == PXSHOT_ERR_CANCELLED);
+    CHECK(pxshot_now_ms() - cancelled < 4 * PXSHOT_GUARD_POLL_MS);
+
+    pxshot_free(client);
+    pxshot_cancel_free(cancel);
+    return 0;
+}
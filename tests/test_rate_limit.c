@@ -0,0 +1,124 @@
+/**
+ * @file test_rate_limit.c
+ * @brief Client-side rate limiting and quota pacing
+ *
+ * Adaptive mode re-reads usage while captures are running. With a single
+ * pooled handle, or as many threads as handles, that refresh must not
+ * wait for a handle the capture itself is holding; an alarm fails the
+ * test if it does. Also checks that an exhausted quota stops captures
+ * before they are sent, and that fail_fast rejects once the bucket is
+ * empty.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+#define THREADS 4
+
+static atomic_int usage_hits;
+static atomic_int capture_hits;
+static atomic_bool quota_spent;
+
+static bool reply_usage(int fd, const char *request) {
+    if (strncmp(request, "GET /v1/usage", 13) != 0) {
+        atomic_fetch_add(&capture_hits, 1);
+        return test_reply_png(fd, request);
+    }
+    atomic_fetch_add(&usage_hits, 1);
+
+    /* The period ends in an hour; a billion screenshots left paces nothing */
+    char end[32];
+    time_t at = time(NULL) + 3600;
+    struct tm tm;
+    strftime(end, sizeof(end), "%Y-%m-%dT%H:%M:%SZ", gmtime_r(&at, &tm));
+    char body[256];
+    int n = snprintf(body, sizeof(body),
+                     "{\"screenshots_used\":%d,\"screenshots_limit\":1000000000,"
+                     "\"period_start\":\"2026-01-01T00:00:00Z\",\"period_end\":\"%s\"}",
+                     atomic_load(&quota_spent) ? 1000000000 : 0, end);
+    return test_respond(fd, 200, "Content-Type: application/json\r\n", body, (size_t)n);
+}
+
+static pxshot_error_t capture(pxshot_client_t *client) {
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com" };
+    pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+    CHECK(resp);
+    pxshot_error_t err = resp->error;
+    pxshot_response_free(resp);
+    return err;
+}
+
+static void *capture_loop(void *arg) {
+    pxshot_client_t *client = (pxshot_client_t *)arg;
+    for (int i = 0; i < 20; i++) {
+        CHECK(capture(client) == PXSHOT_OK);
+        usleep(2000);
+    }
+    return NULL;
+}
+
+int main(void) {
+    int port = test_server_start(reply_usage);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    /* A refresh that waits for a pooled handle never finishes */
+    alarm(20);
+
+    /* One handle: the refresh runs before the capture takes it */
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .pool_max = 1,
+        .rate_limit = { .adaptive = true, .recalibrate_ms = 20 }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+    for (int i = 0; i < 5; i++) {
+        CHECK(capture(client) == PXSHOT_OK);
+        usleep(30 * 1000);
+    }
+    CHECK(atomic_load(&usage_hits) >= 3);
+    CHECK(atomic_load(&capture_hits) == 5);
+
+    /* The plan is used up: captures stop without reaching the server */
+    atomic_store(&quota_spent, true);
+    usleep(30 * 1000);
+    CHECK(capture(client) == PXSHOT_ERR_RATE_LIMITED);
+    CHECK(atomic_load(&capture_hits) == 5);
+    pxshot_rate_limit_stats_t stats;
+    CHECK(pxshot_get_rate_limit_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.quota_exhausted && stats.rejected == 1);
+    atomic_store(&quota_spent, false);
+    pxshot_free(client);
+
+    /* As many threads as handles, refreshing often */
+    config.pool_max = THREADS;
+    client = pxshot_new_with_config(&config);
+    CHECK(client);
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) CHECK(pthread_create(&threads[i], NULL, capture_loop, client) == 0);
+    for (int i = 0; i < THREADS; i++) pthread_join(threads[i], NULL);
+    pxshot_free(client);
+
+    /* A fixed rate with fail_fast rejects once the bucket is empty */
+    config = (pxshot_config_t){
+        .api_key = "test",
+        .base_url = base_url,
+        .rate_limit = { .requests_per_sec = 1, .burst = 1, .fail_fast = true }
+    };
+    client = pxshot_new_with_config(&config);
+    CHECK(client);
+    int before = atomic_load(&capture_hits);
+    CHECK(capture(client) == PXSHOT_OK);
+    CHECK(capture(client) == PXSHOT_ERR_RATE_LIMITED);
+    CHECK(atomic_load(&capture_hits) == before + 1);
+    pxshot_free(client);
+    return 0;
+}
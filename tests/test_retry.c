@@ -0,0 +1,107 @@
+/**
+ * @file test_retry.c
+ * @brief Retries of blocking captures and the retry budget
+ *
+ * The stand-in server fails captures by URL: a few 503s before success,
+ * a 503 that never clears, a 400, and a 503 whose Retry-After is longer
+ * than the policy allows. Each case checks how many times the server was
+ * hit and what the response and transport statistics report.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <stdatomic.h>
+
+#define JSON "Content-Type: application/json\r\n"
+
+static atomic_int hits;
+static atomic_int flaky_left;
+
+static bool reply_failing(int fd, const char *request) {
+    atomic_fetch_add(&hits, 1);
+    static const char busy[] = "{\"error\":\"busy\"}";
+    if (strstr(request, "https://flaky") && atomic_fetch_sub(&flaky_left, 1) > 0) {
+        return test_respond(fd, 503, JSON, busy, sizeof(busy) - 1);
+    }
+    if (strstr(request, "https://down")) return test_respond(fd, 503, JSON, busy, sizeof(busy) - 1);
+    if (strstr(request, "https://later")) {
+        return test_respond(fd, 503, JSON "Retry-After: 60\r\n", busy, sizeof(busy) - 1);
+    }
+    if (strstr(request, "https://bad")) {
+        static const char bad[] = "{\"error\":\"bad url\"}";
+        return test_respond(fd, 400, JSON, bad, sizeof(bad) - 1);
+    }
+    return test_reply_png(fd, request);
+}
+
+static pxshot_client_t *new_client(const char *base_url, int budget_max) {
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .retry = { .max_attempts = 3, .base_delay_ms = 5, .max_delay_ms = 20,
+                   .budget_ratio = 0.01, .budget_max = budget_max }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+    return client;
+}
+
+/* Capture url; returns the number of times the server was hit */
+static int capture(pxshot_client_t *client, const char *url, pxshot_response_t **resp) {
+    atomic_store(&hits, 0);
+    pxshot_screenshot_opts_t opts = { .url = url };
+    *resp = pxshot_screenshot(client, &opts);
+    CHECK(*resp);
+    return atomic_load(&hits);
+}
+
+int main(void) {
+    int port = test_server_start(reply_failing);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_client_t *client = new_client(base_url, 10);
+    pxshot_transport_stats_t stats;
+    pxshot_response_t *resp;
+
+    /* Two 503s, then success on the last attempt */
+    atomic_store(&flaky_left, 2);
+    CHECK(capture(client, "https://flaky", &resp) == 3);
+    CHECK(resp->error == PXSHOT_OK && resp->data_len == 16);
+    CHECK(resp->attempts == 3);
+    CHECK(resp->backoff_ms > 0);
+    pxshot_response_free(resp);
+    CHECK(pxshot_get_transport_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.retries == 2);
+
+    /* Gives up after max_attempts */
+    CHECK(capture(client, "https://down", &resp) == 3);
+    CHECK(resp->error == PXSHOT_ERR_HTTP_ERROR && resp->http_status == 503);
+    CHECK(resp->retryable && resp->attempts == 3);
+    pxshot_response_free(resp);
+
+    /* Not transient: no retry */
+    CHECK(capture(client, "https://bad", &resp) == 1);
+    CHECK(resp->error != PXSHOT_OK && resp->http_status == 400 && !resp->retryable);
+    pxshot_response_free(resp);
+
+    /* The server asks for a longer wait than max_delay_ms */
+    CHECK(capture(client, "https://later", &resp) == 1);
+    CHECK(resp->http_status == 503 && resp->attempts == 1);
+    pxshot_response_free(resp);
+    pxshot_free(client);
+
+    /* A budget of one retry is spent by the first failure */
+    client = new_client(base_url, 1);
+    CHECK(capture(client, "https://down", &resp) == 2);
+    CHECK(resp->http_status == 503);
+    pxshot_response_free(resp);
+    CHECK(pxshot_get_transport_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.retries == 1 && stats.retries_throttled == 1);
+    pxshot_free(client);
+    return 0;
+}
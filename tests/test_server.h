@@ -0,0 +1,152 @@
+/**
+ * @file test_server.h
+ * @brief Shared helpers for the tests: checks and a local stand-in for the API
+ *
+ * The server accepts keep-alive HTTP/1.1 connections on 127.0.0.1, one
+ * thread per connection, and hands each complete request to a reply
+ * function that writes the raw response.
+ */
+
+#ifndef PXSHOT_TEST_SERVER_H
+#define PXSHOT_TEST_SERVER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/* Exit code that makes CTest report the test as skipped */
+#define TEST_SKIP 77
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+/*
+ * Write the response to request (headers and body, NUL-terminated) on fd.
+ * Return false to close the connection afterwards.
+ */
+typedef bool (*test_reply_fn)(int fd, const char *request);
+
+static test_reply_fn test_reply;
+
+static inline bool test_send(int fd, const void *data, size_t len) {
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* Reply with status, extra header lines (each ending in \r\n) and body */
+static inline bool test_respond(int fd, int status, const char *headers, const void *body, size_t len) {
+    char head[512];
+    int n = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\n%sContent-Length: %zu\r\n\r\n",
+                     status, status < 400 ? "OK" : "Error", headers, len);
+    if (n < 0 || (size_t)n >= sizeof(head)) return false;
+    return test_send(fd, head, (size_t)n) && test_send(fd, body, len);
+}
+
+/* Reply 200 with a small PNG-looking body */
+static inline bool test_reply_png(int fd, const char *request) {
+    (void)request;
+    static const char reply[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: image/png\r\n"
+        "Content-Length: 16\r\n"
+        "\r\n"
+        "\x89PNG0123456789ab";
+    return test_send(fd, reply, sizeof(reply) - 1);
+}
+
+/* Serve keep-alive requests on one connection */
+static inline void *test_serve_connection(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char buf[65536];
+    size_t have = 0;
+    buf[0] = '\0';
+
+    for (;;) {
+        char *end = NULL;
+        while (!(end = strstr(buf, "\r\n\r\n"))) {
+            if (have + 1 >= sizeof(buf)) goto done;
+            ssize_t n = recv(fd, buf + have, sizeof(buf) - have - 1, 0);
+            if (n <= 0) goto done;
+            have += (size_t)n;
+            buf[have] = '\0';
+        }
+
+        size_t header_len = (size_t)(end - buf) + 4;
+        size_t body_len = 0;
+        const char *cl = strstr(buf, "Content-Length:");
+        if (!cl) cl = strstr(buf, "content-length:");
+        if (cl && cl < end) body_len = strtoul(cl + 15, NULL, 10);
+        if (header_len + body_len >= sizeof(buf)) goto done;
+        while (have < header_len + body_len) {
+            ssize_t n = recv(fd, buf + have, sizeof(buf) - have - 1, 0);
+            if (n <= 0) goto done;
+            have += (size_t)n;
+        }
+
+        char saved = buf[header_len + body_len];
+        buf[header_len + body_len] = '\0';
+        bool keep = test_reply(fd, buf);
+        buf[header_len + body_len] = saved;
+        if (!keep) goto done;
+
+        have -= header_len + body_len;
+        memmove(buf, buf + header_len + body_len, have);
+        buf[have] = '\0';
+    }
+
+done:
+    close(fd);
+    return NULL;
+}
+
+static inline void *test_serve(void *arg) {
+    int listener = (int)(intptr_t)arg;
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) return NULL;
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, test_serve_connection, (void *)(intptr_t)fd) == 0) {
+            pthread_detach(thread);
+        } else {
+            close(fd);
+        }
+    }
+}
+
+/* Start the server; returns its port, or -1 */
+static inline int test_server_start(test_reply_fn reply) {
+    test_reply = reply;
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    if (listener < 0 ||
+        bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listener, 128) < 0 ||
+        getsockname(listener, (struct sockaddr *)&addr, &addr_len) < 0) {
+        return -1;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, test_serve, (void *)(intptr_t)listener) != 0) return -1;
+    pthread_detach(thread);
+    return ntohs(addr.sin_port);
+}
+
+#endif /* PXSHOT_TEST_SERVER_H */
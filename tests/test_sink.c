@@ -0,0 +1,153 @@
+/**
+ * @file test_sink.c
+ * @brief Streaming captures to callback, fd and FILE sinks
+ *
+ * A 1 MiB image from the stand-in server must reach each kind of sink
+ * byte for byte, with data_len reporting what was written. Error bodies
+ * must stay out of the sink, and a sink that stops taking bytes must
+ * fail the capture with PXSHOT_ERR_SINK_WRITE without another request.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+
+#define IMAGE_SIZE (1 << 20)
+
+static uint8_t image[IMAGE_SIZE];
+static atomic_int hits;
+
+static bool reply_image(int fd, const char *request) {
+    atomic_fetch_add(&hits, 1);
+    if (strstr(request, "https://missing")) {
+        static const char missing[] = "{\"error\":\"page not found\"}";
+        return test_respond(fd, 404, "Content-Type: application/json\r\n", missing, sizeof(missing) - 1);
+    }
+    return test_respond(fd, 200, "Content-Type: image/png\r\n", image, sizeof(image));
+}
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t calls;
+    size_t fail_after;              /* Calls to accept before refusing (0 = never refuse) */
+} collector_t;
+
+static size_t collect(const uint8_t *data, size_t len, void *userdata) {
+    collector_t *c = (collector_t *)userdata;
+    if (c->fail_after && c->calls == c->fail_after) return 0;
+    c->calls++;
+    CHECK(c->len + len <= IMAGE_SIZE);
+    memcpy(c->data + c->len, data, len);
+    c->len += len;
+    return len;
+}
+
+static pxshot_response_t *capture(pxshot_client_t *client, const char *url, const pxshot_sink_t *sink) {
+    pxshot_screenshot_opts_t opts = { .url = url };
+    pxshot_response_t *resp = pxshot_screenshot_to_sink(client, &opts, sink);
+    CHECK(resp);
+    return resp;
+}
+
+/* The file behind fd holds exactly the image */
+static void check_file(int fd) {
+    static uint8_t back[IMAGE_SIZE + 1];
+    CHECK(lseek(fd, 0, SEEK_SET) == 0);
+    size_t got = 0;
+    ssize_t n;
+    while ((n = read(fd, back + got, sizeof(back) - got)) > 0) got += (size_t)n;
+    CHECK(got == IMAGE_SIZE && memcmp(back, image, IMAGE_SIZE) == 0);
+}
+
+int main(void) {
+    for (size_t i = 0; i < IMAGE_SIZE; i++) image[i] = (uint8_t)(i * 31 + (i >> 9));
+
+    int port = test_server_start(reply_image);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_config_t config = { .api_key = "test", .base_url = base_url };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    /* Callback: every byte, in more than one chunk */
+    collector_t c = { .data = malloc(IMAGE_SIZE) };
+    CHECK(c.data);
+    pxshot_sink_t sink = { .type = PXSHOT_SINK_CALLBACK, .write = collect, .userdata = &c };
+    pxshot_response_t *resp = capture(client, "https://example.com", &sink);
+    CHECK(resp->error == PXSHOT_OK && !resp->data && resp->data_len == IMAGE_SIZE);
+    CHECK(c.len == IMAGE_SIZE && c.calls > 1 && memcmp(c.data, image, IMAGE_SIZE) == 0);
+    pxshot_response_free(resp);
+
+    /* File descriptor */
+    char path[] = "/tmp/pxshot_sink_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    unlink(path);
+    sink = (pxshot_sink_t){ .type = PXSHOT_SINK_FD, .fd = fd };
+    resp = capture(client, "https://example.com", &sink);
+    CHECK(resp->error == PXSHOT_OK && resp->data_len == IMAGE_SIZE);
+    pxshot_response_free(resp);
+    check_file(fd);
+    close(fd);
+
+    /* stdio stream */
+    FILE *file = tmpfile();
+    CHECK(file);
+    sink = (pxshot_sink_t){ .type = PXSHOT_SINK_FILE, .file = file };
+    resp = capture(client, "https://example.com", &sink);
+    CHECK(resp->error == PXSHOT_OK && resp->data_len == IMAGE_SIZE);
+    pxshot_response_free(resp);
+    CHECK(fflush(file) == 0);
+    check_file(fileno(file));
+    fclose(file);
+
+    /* An error body goes to error_message, not the sink */
+    c.len = c.calls = 0;
+    sink = (pxshot_sink_t){ .type = PXSHOT_SINK_CALLBACK, .write = collect, .userdata = &c };
+    resp = capture(client, "https://missing", &sink);
+    CHECK(resp->error == PXSHOT_ERR_HTTP_ERROR && resp->http_status == 404);
+    CHECK(resp->error_message && strstr(resp->error_message, "page not found"));
+    CHECK(c.len == 0);
+    pxshot_response_free(resp);
+
+    /* A sink that stops taking bytes fails the capture, once */
+    c.len = c.calls = 0;
+    c.fail_after = 1;
+    atomic_store(&hits, 0);
+    resp = capture(client, "https://example.com", &sink);
+    CHECK(resp->error == PXSHOT_ERR_SINK_WRITE && c.calls == 1);
+    CHECK(atomic_load(&hits) == 1);
+    pxshot_response_free(resp);
+
+    fd = open("/dev/null", O_RDONLY);
+    CHECK(fd >= 0);
+    sink = (pxshot_sink_t){ .type = PXSHOT_SINK_FD, .fd = fd };
+    resp = capture(client, "https://example.com", &sink);
+    CHECK(resp->error == PXSHOT_ERR_SINK_WRITE);
+    pxshot_response_free(resp);
+    close(fd);
+
+    /* Sinks without a destination, and store=true, are rejected up front */
+    atomic_store(&hits, 0);
+    sink = (pxshot_sink_t){ .type = PXSHOT_SINK_FILE };
+    resp = capture(client, "https://example.com", &sink);
+    CHECK(resp->error == PXSHOT_ERR_INVALID_ARG);
+    pxshot_response_free(resp);
+    pxshot_screenshot_opts_t opts = { .url = "https://example.com", .store = true };
+    sink = (pxshot_sink_t){ .type = PXSHOT_SINK_CALLBACK, .write = collect, .userdata = &c };
+    resp = pxshot_screenshot_to_sink(client, &opts, &sink);
+    CHECK(resp && resp->error == PXSHOT_ERR_INVALID_ARG);
+    pxshot_response_free(resp);
+    CHECK(atomic_load(&hits) == 0);
+
+    free(c.data);
+    pxshot_free(client);
+    return 0;
+}
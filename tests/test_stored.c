@@ -0,0 +1,148 @@
+/**
+ * @file test_stored.c
+ * @brief Reuse of stored screenshots and expiry parsing
+ *
+ * Checks the RFC 3339 parser on offsets, fractions and malformed input,
+ * then runs store=true captures against a stand-in server that answers
+ * with expiries in several forms. A result is reused only while it stays
+ * valid past the margin, as its offset says, and is never remembered when
+ * its expiry does not parse.
+ */
+
+#define PXSHOT_IMPLEMENTATION
+#include <pxshot.h>
+
+#include "test_server.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+#define MARGIN_MS 100
+
+static atomic_int hits;
+
+/* Expiry text for a capture of https://example.com/<mode> */
+static void expiry(const char *mode, char *out, size_t size) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct tm tm;
+    time_t at;
+    if (strncmp(mode, "hour", 4) == 0) {
+        /* An hour from now, written in UTC+02:00 */
+        at = ts.tv_sec + 3600 + 2 * 3600;
+        strftime(out, size, "%Y-%m-%dT%H:%M:%S+02:00", gmtime_r(&at, &tm));
+    } else if (strncmp(mode, "past", 4) == 0) {
+        /* A second ago, written in UTC+02:00: the local time reads as the future */
+        at = ts.tv_sec - 1 + 2 * 3600;
+        strftime(out, size, "%Y-%m-%dT%H:%M:%S+02:00", gmtime_r(&at, &tm));
+    } else if (strncmp(mode, "west", 4) == 0) {
+        /* Half an hour from now, written in UTC-05:30: the local time reads as the past */
+        at = ts.tv_sec + 1800 - 5 * 3600 - 1800;
+        strftime(out, size, "%Y-%m-%dT%H:%M:%S-05:30", gmtime_r(&at, &tm));
+    } else if (strncmp(mode, "soon", 4) == 0) {
+        /* Just past the margin, to the millisecond */
+        int64_t ms = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 + MARGIN_MS + 300;
+        at = (time_t)(ms / 1000);
+        size_t n = strftime(out, size, "%Y-%m-%dT%H:%M:%S", gmtime_r(&at, &tm));
+        snprintf(out + n, size - n, ".%03dZ", (int)(ms % 1000));
+    } else {
+        snprintf(out, size, "2099-01-01T00:00:00Zjunk");
+    }
+}
+
+static bool reply_stored(int fd, const char *request) {
+    atomic_fetch_add(&hits, 1);
+    const char *mode = strstr(request, "https://example.com/");
+    char expires[64];
+    expiry(mode ? mode + 20 : "", expires, sizeof(expires));
+    char body[256];
+    int n = snprintf(body, sizeof(body),
+                     "{\"url\":\"https://cdn.pxshot.com/x.png\",\"expires_at\":\"%s\","
+                     "\"width\":1280,\"height\":720,\"size_bytes\":1024}", expires);
+    return test_respond(fd, 200, "Content-Type: application/json\r\n", body, (size_t)n);
+}
+
+/* Capture url with store=true; returns whether the stored result was reused */
+static bool capture(pxshot_client_t *client, const char *url) {
+    pxshot_screenshot_opts_t opts = { .url = url, .store = true };
+    int before = atomic_load(&hits);
+    pxshot_response_t *resp = pxshot_screenshot(client, &opts);
+    CHECK(resp && resp->error == PXSHOT_OK && resp->stored);
+    CHECK(strcmp(resp->stored->url, "https://cdn.pxshot.com/x.png") == 0);
+    bool cached = resp->cached;
+    CHECK(atomic_load(&hits) == before + (cached ? 0 : 1));
+    pxshot_response_free(resp);
+    return cached;
+}
+
+static void check_parse(void) {
+    CHECK(pxshot_parse_time("1970-01-01T00:00:00Z") == 0);
+    CHECK(pxshot_parse_time("2026-03-01T12:34:56Z") == 1772368496000);
+    CHECK(pxshot_parse_time("2026-03-01t12:34:56z") == 1772368496000);
+    CHECK(pxshot_parse_time("2026-03-01T12:34:56") == 1772368496000);
+    CHECK(pxshot_parse_time("2026-03-01T14:34:56+02:00") == 1772368496000);
+    CHECK(pxshot_parse_time("2026-03-01T07:04:56-05:30") == 1772368496000);
+    CHECK(pxshot_parse_time("2026-03-01T12:34:56.250Z") == 1772368496250);
+    CHECK(pxshot_parse_time("2026-03-01T12:34:56.5Z") == 1772368496500);
+    CHECK(pxshot_parse_time("2026-03-01T12:34:56.123456+00:00") == 1772368496123);
+    CHECK(pxshot_parse_time("2024-02-29T00:00:00Z") == 1709164800000);
+
+    static const char *const invalid[] = {
+        "", "2026-03-01", "2026-03-01T12:34Z", "2026-3-01T12:34:56Z", "2026-03-01 12:34:56Z",
+        "2026-13-01T00:00:00Z", "2026-00-01T00:00:00Z", "2026-04-31T00:00:00Z",
+        "2023-02-29T00:00:00Z", "2026-03-01T24:00:00Z", "2026-03-01T12:60:00Z",
+        "2026-03-01T12:34:61Z", "2026-03-01T12:34:56.Z", "2026-03-01T12:34:56Zjunk",
+        "2026-03-01T12:34:56+02", "2026-03-01T12:34:56+2:00", "2026-03-01T12:34:56+0200",
+        "2026-03-01T12:34:56+24:00", "2026-03-01T12:34:56+02:60", "2026-03-01T12:34:56 "
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        if (pxshot_parse_time(invalid[i]) != -1) {
+            fprintf(stderr, "parsed invalid time \"%s\"\n", invalid[i]);
+            exit(1);
+        }
+    }
+    CHECK(pxshot_parse_time(NULL) == -1);
+}
+
+int main(void) {
+    check_parse();
+
+    int port = test_server_start(reply_stored);
+    CHECK(port > 0);
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    pxshot_config_t config = {
+        .api_key = "test",
+        .base_url = base_url,
+        .stored_reuse = { .max_entries = 16, .margin_ms = MARGIN_MS }
+    };
+    pxshot_client_t *client = pxshot_new_with_config(&config);
+    CHECK(client);
+
+    /* Valid for an hour, as the offset says */
+    CHECK(!capture(client, "https://example.com/hour"));
+    CHECK(capture(client, "https://example.com/hour"));
+    CHECK(!capture(client, "https://example.com/west"));
+    CHECK(capture(client, "https://example.com/west"));
+
+    /* Already expired once the offset is applied */
+    CHECK(!capture(client, "https://example.com/past"));
+    CHECK(!capture(client, "https://example.com/past"));
+
+    /* An expiry that does not parse is not remembered */
+    CHECK(!capture(client, "https://example.com/junk"));
+    CHECK(!capture(client, "https://example.com/junk"));
+
+    /* Reused until only the margin is left */
+    CHECK(!capture(client, "https://example.com/soon"));
+    CHECK(capture(client, "https://example.com/soon"));
+    usleep(400 * 1000);
+    CHECK(!capture(client, "https://example.com/soon"));
+
+    pxshot_cache_stats_t stats;
+    CHECK(pxshot_get_cache_stats(client, &stats) == PXSHOT_OK);
+    CHECK(stats.stored_hits == 3 && stats.stored_entries == 3);
+    pxshot_free(client);
+    return 0;
+}